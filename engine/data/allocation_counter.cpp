@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace Sapphire;
+
+#ifdef DEBUG
+
+static thread_local bool tls_counting = false;
+
+// Shared, so allocations made by threads that joined in land in the same count
+static std::atomic<size_t> allocation_count {0};
+
+// The array and nothrow forms call this one by default, over-aligned allocations aren't counted
+void *operator new(size_t size) {
+    if (tls_counting) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    while (true) {
+        void *p_memory = std::malloc(size);
+
+        if (p_memory != nullptr) {
+            return p_memory;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        handler();
+    }
+}
+
+void operator delete(void *p_memory) noexcept {
+    std::free(p_memory);
+}
+
+void operator delete(void *p_memory, size_t) noexcept {
+    std::free(p_memory);
+}
+
+void AllocationCounter::begin() {
+    allocation_count.store(0);
+    tls_counting = true;
+}
+
+size_t AllocationCounter::end() {
+    tls_counting = false;
+    return allocation_count.load();
+}
+
+bool AllocationCounter::is_counting() {
+    return tls_counting;
+}
+
+void AllocationCounter::join() {
+    tls_counting = true;
+}
+
+void AllocationCounter::leave() {
+    tls_counting = false;
+}
+
+#else
+
+void AllocationCounter::begin() {
+
+}
+
+size_t AllocationCounter::end() {
+    return 0;
+}
+
+bool AllocationCounter::is_counting() {
+    return false;
+}
+
+void AllocationCounter::join() {
+
+}
+
+void AllocationCounter::leave() {
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_ALLOCATION_COUNTER_HPP
+#define SAPPHIRE_ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+
+namespace Sapphire {
+    // Counts calls to the global operator new made by the calling thread between begin() and end()
+    // Other threads only add to the count between join() and leave(), e.g. WorkerPool threads running a job for the caller
+    // Only DEBUG builds replace operator new, otherwise end() always returns 0
+    class AllocationCounter {
+    public:
+        AllocationCounter() = delete;
+
+        static void begin();
+        static size_t end();
+
+        // Whether the calling thread's allocations are currently counted
+        static bool is_counting();
+
+        static void join();
+        static void leave();
+    };
+}
+
+#endif//SAPPHIRE_ALLOCATION_COUNTER_HPP
@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace Sapphire;
+
+FrameArena::FrameArena(size_t capacity) {
+    push_block(capacity);
+}
+
+void FrameArena::push_block(size_t size) {
+    Block block {};
+    block.data = std::unique_ptr<char[]>(new char[size]);
+    block.size = size;
+
+    blocks.push_back(std::move(block));
+}
+
+void *FrameArena::alloc(size_t size, size_t alignment) {
+    Block *p_block = &blocks.back();
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(p_block->data.get());
+    size_t aligned = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+
+    if (aligned + size > p_block->size) {
+        // Overflow blocks are at least as large as the primary one, so a busy frame doesn't add one per allocation
+        overflow_used += offset;
+        offset = 0;
+
+        push_block(std::max(size + alignment, blocks.front().size));
+
+        p_block = &blocks.back();
+        base = reinterpret_cast<uintptr_t>(p_block->data.get());
+        aligned = ((base + alignment - 1) & ~(alignment - 1)) - base;
+    }
+
+    offset = aligned + size;
+    return p_block->data.get() + aligned;
+}
+
+void FrameArena::free(void *p_memory, size_t size) {
+    char *p_end = static_cast<char*>(p_memory) + size;
+
+    if (p_end == blocks.back().data.get() + offset) {
+        offset -= size;
+    }
+}
+
+void FrameArena::reset() {
+    // Last frame didn't fit, grow the primary block so the same load fits next time
+    if (blocks.size() > 1) {
+        size_t capacity = blocks.front().size;
+
+        while (capacity < overflow_used + offset) {
+            capacity *= 2;
+        }
+
+        blocks.clear();
+        push_block(capacity);
+    }
+
+    offset = 0;
+    overflow_used = 0;
+}
+
+size_t FrameArena::get_capacity() const {
+    return blocks.front().size;
+}
+
+size_t FrameArena::get_used() const {
+    return overflow_used + offset;
+}
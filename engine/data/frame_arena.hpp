@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_FRAME_ARENA_HPP
+#define SAPPHIRE_FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Sapphire {
+    // A linear allocator for memory that only has to live until the next frame begins
+    // Allocating bumps an offset, nothing is given back until reset() drops everything at once
+    // If a frame runs out of space an overflow block is added, the next reset() merges them so later frames fit in one
+    // Not thread safe, only the main thread may use the arena
+    class FrameArena {
+    protected:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        // The first block is the primary one, any others are overflow from this frame
+        std::vector<Block> blocks;
+        size_t offset = 0;
+
+        // The bytes used by every block before the current one, used to size the merged block
+        size_t overflow_used = 0;
+
+        void push_block(size_t size);
+
+    public:
+        FrameArena() = delete;
+        explicit FrameArena(size_t capacity);
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void *alloc(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        // Only the most recent allocation is actually given back, anything else waits for reset()
+        void free(void *p_memory, size_t size);
+
+        void reset();
+
+        [[nodiscard]]
+        size_t get_capacity() const;
+
+        [[nodiscard]]
+        size_t get_used() const;
+    };
+
+    // An STL allocator that takes its memory from a FrameArena
+    // Containers using it must not outlive the frame, and must not be touched by other threads
+    template<typename T>
+    class FrameAllocator {
+        template<typename U>
+        friend class FrameAllocator;
+
+    protected:
+        FrameArena *p_arena;
+
+    public:
+        using value_type = T;
+
+        FrameAllocator(FrameArena *p_arena) noexcept : p_arena(p_arena) {}
+
+        template<typename U>
+        FrameAllocator(const FrameAllocator<U> &other) noexcept : p_arena(other.p_arena) {}
+
+        T *allocate(size_t count) {
+            return static_cast<T*>(p_arena->alloc(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *p_memory, size_t count) noexcept {
+            p_arena->free(p_memory, count * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const FrameAllocator<U> &rhs) const noexcept {
+            return p_arena == rhs.p_arena;
+        }
+
+        template<typename U>
+        bool operator!=(const FrameAllocator<U> &rhs) const noexcept {
+            return p_arena != rhs.p_arena;
+        }
+    };
+
+    template<typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
+
+#endif//SAPPHIRE_FRAME_ARENA_HPP
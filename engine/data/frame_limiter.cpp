@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "frame_limiter.hpp"
+
+#include <thread>
+
+using namespace Sapphire;
+
+void FrameLimiter::set_target_fps(int fps) {
+    Clock::duration new_frame_time {};
+
+    if (fps > 0) {
+        new_frame_time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    }
+
+    if (new_frame_time != frame_time) {
+        frame_time = new_frame_time;
+        next_frame = Clock::time_point {};
+    }
+}
+
+void FrameLimiter::wait() {
+    if (frame_time == Clock::duration::zero()) {
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+
+    if (next_frame == Clock::time_point {} || now - next_frame > frame_time) {
+        next_frame = now + frame_time;
+        return;
+    }
+
+    if (next_frame - now > spin_time) {
+        std::this_thread::sleep_for(next_frame - now - spin_time);
+    }
+
+    while (Clock::now() < next_frame) {
+        std::this_thread::yield();
+    }
+
+    next_frame += frame_time;
+}
+
+void FrameLimiter::set_spin_time(Clock::duration spin_time) {
+    this->spin_time = spin_time;
+}
@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_FRAME_LIMITER_HPP
+#define SAPPHIRE_FRAME_LIMITER_HPP
+
+#include <chrono>
+
+namespace Sapphire {
+    // Paces a loop to a fixed rate
+    // OS sleeps tend to overshoot by a millisecond or more, so most of the wait is slept and the rest is spun
+    class FrameLimiter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    protected:
+        // Zero means no limit
+        Clock::duration frame_time {};
+        Clock::time_point next_frame {};
+
+        // How much of the wait is spun rather than slept
+        Clock::duration spin_time = std::chrono::microseconds(1500);
+
+    public:
+        // 0 disables the limit, setting the same rate again keeps the current schedule
+        void set_target_fps(int fps);
+
+        // Blocks until the next frame is due
+        // A loop that falls more than a frame behind starts a new schedule rather than rushing to catch up
+        void wait();
+
+        void set_spin_time(Clock::duration spin_time);
+    };
+}
+
+#endif//SAPPHIRE_FRAME_LIMITER_HPP
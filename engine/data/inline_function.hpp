@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_INLINE_FUNCTION_HPP
+#define SAPPHIRE_INLINE_FUNCTION_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Sapphire {
+    template<typename Signature, size_t Capacity>
+    class InlineFunction;
+
+    // A move-only std::function that never allocates
+    // The callable is stored inside the object itself, anything larger than Capacity bytes fails to compile
+    template<typename R, typename... Args, size_t Capacity>
+    class InlineFunction<R(Args...), Capacity> {
+    protected:
+        using InvokeFunc = R (*)(void*, Args...);
+
+        // Move constructs the callable at dst out of src, then destroys src
+        using MoveFunc = void (*)(void*, void*);
+        using DestroyFunc = void (*)(void*);
+
+        alignas(std::max_align_t) unsigned char storage[Capacity];
+
+        InvokeFunc p_invoke = nullptr;
+        MoveFunc p_move = nullptr;
+        DestroyFunc p_destroy = nullptr;
+
+        void move_from(InlineFunction &other) {
+            if (other.p_invoke == nullptr) {
+                return;
+            }
+
+            other.p_move(storage, other.storage);
+
+            p_invoke = other.p_invoke;
+            p_move = other.p_move;
+            p_destroy = other.p_destroy;
+
+            other.p_invoke = nullptr;
+            other.p_move = nullptr;
+            other.p_destroy = nullptr;
+        }
+
+    public:
+        InlineFunction() = default;
+        InlineFunction(std::nullptr_t) {}
+
+        template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+        InlineFunction(F &&func) {
+            using Callable = std::decay_t<F>;
+
+            static_assert(sizeof(Callable) <= Capacity, "Callable is too large for this InlineFunction, capture less or raise the capacity");
+            static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable is over-aligned");
+            static_assert(std::is_nothrow_move_constructible_v<Callable>, "Callable must be nothrow move constructible");
+
+            new (storage) Callable(std::forward<F>(func));
+
+            p_invoke = [](void *p_callable, Args... args) -> R {
+                return (*static_cast<Callable*>(p_callable))(std::forward<Args>(args)...);
+            };
+
+            p_move = [](void *p_dst, void *p_src) {
+                new (p_dst) Callable(std::move(*static_cast<Callable*>(p_src)));
+                static_cast<Callable*>(p_src)->~Callable();
+            };
+
+            p_destroy = [](void *p_callable) {
+                static_cast<Callable*>(p_callable)->~Callable();
+            };
+        }
+
+        InlineFunction(InlineFunction &&other) noexcept {
+            move_from(other);
+        }
+
+        InlineFunction& operator=(InlineFunction &&other) noexcept {
+            if (this != &other) {
+                reset();
+                move_from(other);
+            }
+
+            return *this;
+        }
+
+        InlineFunction(const InlineFunction&) = delete;
+        InlineFunction& operator=(const InlineFunction&) = delete;
+
+        ~InlineFunction() {
+            reset();
+        }
+
+        void reset() {
+            if (p_destroy != nullptr) {
+                p_destroy(storage);
+            }
+
+            p_invoke = nullptr;
+            p_move = nullptr;
+            p_destroy = nullptr;
+        }
+
+        explicit operator bool() const {
+            return p_invoke != nullptr;
+        }
+
+        R operator()(Args... args) {
+            return p_invoke(storage, std::forward<Args>(args)...);
+        }
+    };
+}
+
+#endif//SAPPHIRE_INLINE_FUNCTION_HPP
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_MPSC_QUEUE_HPP
+#define SAPPHIRE_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <vector>
+
+namespace Sapphire {
+    // A lock-free multi-producer single-consumer queue
+    // Producers push onto an intrusive stack with a CAS, the consumer takes the whole stack at once
+    // Taking everything in a single exchange means the consumer never races a producer over a node (no ABA)
+    template<typename T>
+    class MPSCQueue {
+    protected:
+        struct Node {
+            T value;
+            Node *p_next = nullptr;
+        };
+
+        std::atomic<Node*> p_head {nullptr};
+
+    public:
+        MPSCQueue() = default;
+
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+        ~MPSCQueue() {
+            std::vector<T> discard;
+            drain(discard);
+        }
+
+        // Safe to call from any thread
+        void push(T value) {
+            Node *p_node = new Node{std::move(value), p_head.load(std::memory_order_relaxed)};
+
+            while (!p_head.compare_exchange_weak(p_node->p_next, p_node, std::memory_order_release, std::memory_order_relaxed)) {
+                // p_next was refreshed by the failed exchange, try again
+            }
+        }
+
+        // Only one thread may drain at a time
+        // Appends every queued value to out in the order they were pushed
+        void drain(std::vector<T> &out) {
+            Node *p_node = p_head.exchange(nullptr, std::memory_order_acquire);
+
+            // The stack is newest first, so reverse it
+            Node *p_reversed = nullptr;
+
+            while (p_node != nullptr) {
+                Node *p_next = p_node->p_next;
+                p_node->p_next = p_reversed;
+                p_reversed = p_node;
+                p_node = p_next;
+            }
+
+            while (p_reversed != nullptr) {
+                Node *p_next = p_reversed->p_next;
+                out.push_back(std::move(p_reversed->value));
+
+                delete p_reversed;
+                p_reversed = p_next;
+            }
+        }
+
+        [[nodiscard]]
+        bool empty() const {
+            return p_head.load(std::memory_order_acquire) == nullptr;
+        }
+    };
+}
+
+#endif//SAPPHIRE_MPSC_QUEUE_HPP
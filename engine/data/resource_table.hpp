@@ -0,0 +1,206 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_RESOURCE_TABLE_HPP
+#define SAPPHIRE_RESOURCE_TABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Sapphire {
+    // A typed reference into a ResourceTable
+    // The generation is bumped every time a slot is reused, so a handle to a destroyed resource never resolves to its successor
+    // A generation of 0 is never handed out, a default constructed handle is always null
+    template<typename T>
+    struct Handle {
+        uint32_t index = 0;
+        uint32_t generation = 0;
+
+        [[nodiscard]]
+        bool is_null() const {
+            return generation == 0;
+        }
+
+        bool operator==(const Handle &rhs) const {
+            return index == rhs.index && generation == rhs.generation;
+        }
+
+        bool operator!=(const Handle &rhs) const {
+            return !(*this == rhs);
+        }
+    };
+
+    // Densely packed storage for resources referenced through a Handle
+    // Slots live in fixed size pages that are never moved or freed, so a looked up pointer stays valid until its resource is destroyed
+    // Lookups are lock-free and safe from any thread, creating and destroying take a lock
+    // A live slot has an odd generation, destroying it bumps the generation to the next even number
+    template<typename T>
+    class ResourceTable {
+    public:
+        static constexpr uint32_t PAGE_SIZE = 256;
+        static constexpr uint32_t MAX_PAGES = 4096;
+
+    protected:
+        struct Page {
+            alignas(T) unsigned char storage[PAGE_SIZE][sizeof(T)];
+            std::atomic<uint32_t> generations[PAGE_SIZE] {};
+        };
+
+        std::unique_ptr<std::atomic<Page*>[]> pages;
+        uint32_t page_count = 0;
+        uint32_t slot_count = 0;
+
+        // Guards page_count, slot_count and free_slots
+        std::mutex mutex;
+        std::vector<uint32_t> free_slots;
+
+        T *get_slot(Page *p_page, uint32_t index) {
+            return reinterpret_cast<T*>(p_page->storage[index % PAGE_SIZE]);
+        }
+
+        // Takes a free slot, adding a page if every slot is in use
+        uint32_t reserve_slot() {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!free_slots.empty()) {
+                uint32_t index = free_slots.back();
+                free_slots.pop_back();
+
+                return index;
+            }
+
+            if (slot_count == page_count * PAGE_SIZE) {
+                if (page_count == MAX_PAGES) {
+                    throw std::runtime_error("ResourceTable is full!");
+                }
+
+                pages[page_count].store(new Page(), std::memory_order_release);
+                page_count++;
+            }
+
+            return slot_count++;
+        }
+
+    public:
+        ResourceTable() : pages(new std::atomic<Page*>[MAX_PAGES]) {
+            for (uint32_t p = 0; p < MAX_PAGES; p++) {
+                pages[p].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ResourceTable(const ResourceTable&) = delete;
+        ResourceTable& operator=(const ResourceTable&) = delete;
+
+        ~ResourceTable() {
+            for (uint32_t p = 0; p < page_count; p++) {
+                Page *p_page = pages[p].load(std::memory_order_relaxed);
+
+                for (uint32_t s = 0; s < PAGE_SIZE; s++) {
+                    if (p_page->generations[s].load(std::memory_order_relaxed) % 2 == 1) {
+                        get_slot(p_page, s)->~T();
+                    }
+                }
+
+                delete p_page;
+            }
+        }
+
+        // Constructs the resource in place, the handle only becomes visible to lookups once construction has finished
+        template<typename... Args>
+        Handle<T> create(Args&&... args) {
+            uint32_t index = reserve_slot();
+            Page *p_page = pages[index / PAGE_SIZE].load(std::memory_order_acquire);
+
+            try {
+                new (get_slot(p_page, index)) T(std::forward<Args>(args)...);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                free_slots.push_back(index);
+
+                throw;
+            }
+
+            std::atomic<uint32_t>& generation = p_page->generations[index % PAGE_SIZE];
+            uint32_t live_generation = generation.load(std::memory_order_relaxed) + 1;
+            generation.store(live_generation, std::memory_order_release);
+
+            return Handle<T> {index, live_generation};
+        }
+
+        // Returns nullptr for null or stale handles
+        T *get(Handle<T> handle) {
+            if (handle.is_null() || handle.index / PAGE_SIZE >= MAX_PAGES) {
+                return nullptr;
+            }
+
+            Page *p_page = pages[handle.index / PAGE_SIZE].load(std::memory_order_acquire);
+
+            if (p_page == nullptr || p_page->generations[handle.index % PAGE_SIZE].load(std::memory_order_acquire) != handle.generation) {
+                return nullptr;
+            }
+
+            return get_slot(p_page, handle.index);
+        }
+
+        // Destroys the resource right away, returns false if the handle was already stale
+        // Any deferral (waiting on frames in flight) is up to the owner of the table
+        bool destroy(Handle<T> handle) {
+            T *p_resource = get(handle);
+
+            if (p_resource == nullptr) {
+                return false;
+            }
+
+            Page *p_page = pages[handle.index / PAGE_SIZE].load(std::memory_order_acquire);
+            std::atomic<uint32_t>& generation = p_page->generations[handle.index % PAGE_SIZE];
+
+            // Stale the handle before tearing the resource down, so lookups racing with us see nullptr instead of a dead object
+            uint32_t expected = handle.generation;
+            if (!generation.compare_exchange_strong(expected, handle.generation + 1, std::memory_order_acq_rel)) {
+                return false;
+            }
+
+            p_resource->~T();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            free_slots.push_back(handle.index);
+
+            return true;
+        }
+
+        [[nodiscard]]
+        uint32_t get_live_count() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return slot_count - static_cast<uint32_t>(free_slots.size());
+        }
+    };
+}
+
+#endif//SAPPHIRE_RESOURCE_TABLE_HPP
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_SPSC_QUEUE_HPP
+#define SAPPHIRE_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace Sapphire {
+    // A lock-free single-producer single-consumer ring of fixed capacity
+    // Nothing is allocated after construction, so it's safe to use on the render path
+    // Each index is only ever written by one side, so a release store / acquire load pair is all the sync needed
+    template<typename T, size_t Capacity>
+    class SPSCQueue {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two!");
+
+    protected:
+        T values[Capacity] {};
+
+        // Kept on separate cache lines so the producer and consumer don't fight over them
+        alignas(64) std::atomic<size_t> head {0};
+        alignas(64) std::atomic<size_t> tail {0};
+
+    public:
+        SPSCQueue() = default;
+
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        // Producer only, returns false if the queue is full
+        bool try_push(const T &value) {
+            size_t current_tail = tail.load(std::memory_order_relaxed);
+
+            if (current_tail - head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+
+            values[current_tail & (Capacity - 1)] = value;
+            tail.store(current_tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Consumer only, returns false if the queue is empty
+        bool try_pop(T &out) {
+            size_t current_head = head.load(std::memory_order_relaxed);
+
+            if (current_head == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            out = values[current_head & (Capacity - 1)];
+            head.store(current_head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Only exact when called from one of the two sides while the other is idle
+        [[nodiscard]]
+        size_t size() const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]]
+        bool empty() const {
+            return size() == 0;
+        }
+    };
+}
+
+#endif//SAPPHIRE_SPSC_QUEUE_HPP
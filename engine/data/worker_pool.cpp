@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "worker_pool.hpp"
+
+#include <data/allocation_counter.hpp>
+
+using namespace Sapphire;
+
+void WorkerPool::run() {
+    uint64_t seen_generation = 0;
+
+    while (true) {
+        Job *p_current_job;
+        size_t current_count;
+        bool counting;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen_generation]() { return generation != seen_generation || !running; });
+
+            if (!running) {
+                return;
+            }
+
+            seen_generation = generation;
+
+            // Woke up after the caller already finished the job on its own
+            if (p_job == nullptr) {
+                continue;
+            }
+
+            p_current_job = p_job;
+            current_count = job_count;
+            counting = count_allocations;
+            busy_workers++;
+        }
+
+        if (counting) {
+            AllocationCounter::join();
+        }
+
+        work(p_current_job, current_count);
+
+        if (counting) {
+            AllocationCounter::leave();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy_workers--;
+        }
+
+        done.notify_all();
+    }
+}
+
+void WorkerPool::work(Job *p_job, size_t count) {
+    size_t index;
+
+    while ((index = next_index.fetch_add(1)) < count) {
+        try {
+            (*p_job)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (job_exception == nullptr) {
+                job_exception = std::current_exception();
+            }
+        }
+
+        remaining.fetch_sub(1);
+    }
+}
+
+WorkerPool::WorkerPool(size_t thread_count) {
+    threads.reserve(thread_count);
+
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    wake.notify_all();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallel_for(size_t count, Job job) {
+    if (count == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        p_job = &job;
+        job_count = count;
+        count_allocations = AllocationCounter::is_counting();
+
+        next_index.store(0);
+        remaining.store(count);
+
+        generation++;
+    }
+
+    wake.notify_all();
+
+    work(&job, count);
+
+    // Workers that woke up late may still be about to take an index, the job has to outlive them
+    std::exception_ptr exception;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return remaining.load() == 0 && busy_workers == 0; });
+
+        p_job = nullptr;
+        std::swap(exception, job_exception);
+    }
+
+    if (exception != nullptr) {
+        std::rethrow_exception(exception);
+    }
+}
+
+size_t WorkerPool::get_thread_count() const {
+    return threads.size();
+}
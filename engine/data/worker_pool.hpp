@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_WORKER_POOL_HPP
+#define SAPPHIRE_WORKER_POOL_HPP
+
+#include <data/inline_function.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Sapphire {
+    // A fixed set of threads that split a loop between them, the calling thread joins in too
+    // Meant for a handful of large jobs per frame (e.g. recording command buffers), not fine grained tasks
+    // Jobs are stored inline, so running one never allocates
+    class WorkerPool {
+    public:
+        using Job = InlineFunction<void(size_t), 48>;
+
+    protected:
+        std::vector<std::thread> threads;
+
+        // Guards everything below except the atomics
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        // Bumped for every parallel_for, workers join in whenever it changes
+        uint64_t generation = 0;
+        bool running = true;
+
+        Job *p_job = nullptr;
+        size_t job_count = 0;
+
+        // The caller was counting allocations, workers count theirs towards it while running the job
+        bool count_allocations = false;
+
+        // Workers still inside the current job, parallel_for only returns once they've all left it
+        size_t busy_workers = 0;
+
+        std::atomic<size_t> next_index {0};
+        std::atomic<size_t> remaining {0};
+
+        // The first exception a job threw, rethrown on the calling thread
+        std::exception_ptr job_exception;
+
+        void run();
+
+        // Takes indices until there are none left
+        void work(Job *p_job, size_t count);
+
+    public:
+        WorkerPool() = delete;
+        explicit WorkerPool(size_t thread_count);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // Calls job(i) for every i in [0, count), returns once every call has returned
+        // Only one thread may call this at a time
+        void parallel_for(size_t count, Job job);
+
+        [[nodiscard]]
+        size_t get_thread_count() const;
+    };
+}
+
+#endif//SAPPHIRE_WORKER_POOL_HPP
@@ -28,12 +28,19 @@ SOFTWARE.
 #include <graphics/vulkan_provider.hpp>
 #include <graphics/mesh_buffer.hpp>
 #include <graphics/shader.hpp>
+#include <graphics/targets/image_render_target.hpp>
 #include <graphics/targets/window_render_target.hpp>
 
+#include <data/allocation_counter.hpp>
+#include <data/size_tools.hpp>
+#include <data/worker_pool.hpp>
+
 #include <window.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 
 #include <SDL.h>
 
@@ -50,7 +57,7 @@ Engine *Engine::get_instance() {
 }
 
 // TODO: Temp
-Graphics::MeshBuffer* test_mesh;
+Graphics::MeshBufferHandle test_mesh;
 
 //
 // Ctor
@@ -61,25 +68,68 @@ Engine::Engine(const EngineConfig& config) {
         throw std::runtime_error("Multiple engine instances are not allowed in the same process!");
     }
 
-    SDL_Init(SDL_INIT_EVERYTHING);
+    bool headless = config.graphics == RequestedPipeline::Headless;
+
+    // SDL video fails to initialize without a display, headless only needs events and timers
+    SDL_Init(headless ? (SDL_INIT_EVENTS | SDL_INIT_TIMER) : SDL_INIT_EVERYTHING);
 
     app_info = config.app_info;
 
+    max_fps = config.max_fps;
+    background_fps = config.background_fps;
+    low_latency = config.low_latency;
+
     // Initialize our chosen graphics stack window
     // A stack of "None" allocates no window unless requested
     if (config.graphics != RequestedPipeline::None) {
         // First the window
-        main_window = new Window();
-        main_window->initialize();
-        main_window->set_title("Sapphire");
-        main_window->set_resizable(true);
+        if (!headless) {
+            main_window = new Window();
+            main_window->initialize();
+            main_window->set_title("Sapphire");
+            main_window->set_resizable(true);
+
+            windows.push_back(main_window);
+        }
 
         // Creates our VulkanProvider for pipelines
         vk_provider = new Graphics::VulkanProvider();
+        vk_provider->set_frames_in_flight(static_cast<uint32_t>(config.frames_in_flight));
+        vk_provider->set_max_queued_frames(static_cast<uint32_t>(config.max_queued_frames));
+        vk_provider->set_vsync(config.vsync);
+        vk_provider->set_srgb(config.srgb);
+        vk_provider->set_d32(config.d32);
+        vk_provider->set_swapchain_images(static_cast<uint32_t>(config.swapchain_images));
+        vk_provider->set_present_thread(config.present_thread);
+        vk_provider->set_pool_idle_frames(static_cast<uint32_t>(config.memory_pool_idle_frames));
+        vk_provider->set_defrag_budget(SizeTools::kib_to_bytes(config.defrag_kib_per_frame));
+        vk_provider->set_upload_budget(SizeTools::kib_to_bytes(config.upload_kib_per_frame));
+        vk_provider->set_uniform_ring_size(SizeTools::kib_to_bytes(config.uniform_ring_kib_per_frame));
+        vk_provider->set_frame_arena_size(SizeTools::kib_to_bytes(config.frame_arena_kib));
         vk_provider->initialize(this);
 
         // We don't initialize the render target of the main window!
         // It is already initialized as part of the Vulkan bootstrapping process
+        if (headless) {
+            VkExtent2D vk_extent {
+                static_cast<uint32_t>(config.window_width),
+                static_cast<uint32_t>(config.window_height)
+            };
+
+            offscreen_target = new Graphics::ImageRenderTarget(vk_provider, vk_extent);
+            render_targets.push_back(offscreen_target);
+        }
+
+        // The main thread records too, so it's left out of the worker count
+        int render_threads = config.render_threads;
+
+        if (render_threads < 0) {
+            render_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+        }
+
+        if (render_threads > 0) {
+            worker_pool = new WorkerPool(static_cast<size_t>(render_threads));
+        }
 
         // TODO: TEMP
         // CLion's formatting is wonky asf here :)
@@ -100,7 +150,7 @@ Engine::Engine(const EngineConfig& config) {
                 0, 2, 1
         };
 
-        test_mesh = new Graphics::MeshBuffer(vk_provider, vertices, triangles);
+        test_mesh = vk_provider->create_mesh_buffer(vertices, triangles);
     }
 
     // TODO: Is this stupidly dangerous?
@@ -116,6 +166,10 @@ Engine::~Engine() {
         singleton = nullptr;
     }
 
+    // Stops and joins the recording threads, they sit idle once parallel_for has returned
+    delete worker_pool;
+    worker_pool = nullptr;
+
     if (has_verbosity(VerbosityFlags::Engine)) {
         LOG_ENGINE("Dtor called!");
     }
@@ -125,51 +179,222 @@ Engine::~Engine() {
 // State
 //
 void Engine::tick_graphics() {
+#ifdef DEBUG
+    // Steady-state frames should only allocate from the frame arena
+    AllocationCounter::begin();
+#endif
+
     // TODO: Better place for flush?
     vk_provider->flush();
+
+    // Only blocks on the fence of the frame slot we're about to reuse
     vk_provider->begin_frame();
 
     //
-    // Main window
+    // Gather the targets (the offscreen target takes the main window's place when headless)
     //
-    auto active_rt = main_window->begin_frame(this);
+    frame_targets.clear();
+    frame_windows.clear();
+
+    // Swapchains are rebuilt and acquired on the main thread, only recording is spread across threads
+    // A minimized window has an empty surface, there is nothing to draw to
+    for (Window *p_window : windows) {
+        if (p_window->is_minimized()) {
+            continue;
+        }
 
-    // TODO: Rather than passing in the command buffers, maybe we should just pass around the render target?
-    vk_provider->get_shader_fallback()->bind(active_rt->get_vk_command_buffer());
-    test_mesh->draw(active_rt->get_vk_command_buffer());
+        Graphics::WindowRenderTarget *p_target = p_window->update_render_target(this);
 
-    main_window->end_frame(this);
+        // The window can still be minimized between the check and the acquire, it stays dirty until it's rebuilt
+        if (!p_target->acquire(vk_provider)) {
+            continue;
+        }
 
-    main_window->render(this);
-    main_window->present(this);
+        frame_targets.push_back(p_target);
+        frame_windows.push_back(p_target);
+    }
+
+    frame_targets.insert(frame_targets.end(), render_targets.begin(), render_targets.end());
 
     //
-    // Child windows
+    // Record, every target has a command pool of its own
+    // With every window minimized there's nothing to record, the frame slot still cycles so uploads and releases keep moving
     //
+    if (worker_pool != nullptr && frame_targets.size() > 1) {
+        worker_pool->parallel_for(frame_targets.size(), [this](size_t t) {
+            record_target(frame_targets[t]);
+        });
+    } else {
+        for (Graphics::RenderTarget *p_target : frame_targets) {
+            record_target(p_target);
+        }
+    }
 
-    // TODO: Child windows / render targets
+    // One submit and one present for every target, offscreen targets have nothing to present
+    // Both are no-ops without targets, an unsubmitted frame leaves its fence signaled for the next wait
+    vk_provider->submit_targets(frame_targets.data(), frame_targets.size());
+    vk_provider->present_targets(frame_windows.data(), frame_windows.size());
 
     vk_provider->end_frame();
+
+#ifdef DEBUG
+    size_t allocations = AllocationCounter::end();
+
+    // The first frames fill caches and grow containers, so they're allowed to allocate
+    if (allocations > 0 && vk_provider->get_frame_number() > ALLOCATION_WARMUP_FRAMES) {
+        LOG_ENGINE("Warning: tick_graphics made " << allocations << " heap allocations on frame " << vk_provider->get_frame_number());
+    }
+#endif
+}
+
+void Engine::record_target(Graphics::RenderTarget *p_target) {
+    p_target->begin_target(vk_provider);
+
+    // TODO: Rather than passing in the command buffers, maybe we should just pass around the render target?
+    vk_provider->get_shader(vk_provider->get_shader_fallback())->bind(p_target->get_vk_command_buffer());
+    vk_provider->get_mesh_buffer(test_mesh)->draw(vk_provider, p_target->get_vk_command_buffer());
+
+    p_target->end_target(vk_provider);
+}
+
+Window *Engine::find_window(uint32_t id) {
+    for (Window *p_window : windows) {
+        if (p_window->get_id() == id) {
+            return p_window;
+        }
+    }
+
+    return nullptr;
 }
 
 Engine::StepResult Engine::tick() {
+    // Nobody sees frames drawn to unfocused windows, so they're drawn at the background rate instead
+    bool minimized = !windows.empty() && render_targets.empty();
+    bool focused = false;
+
+    for (Window *p_window : windows) {
+        minimized &= p_window->is_minimized();
+        focused |= p_window->has_focus();
+    }
+
+    bool background = !windows.empty() && (minimized || !focused);
+
+    // Pacing happens before input is polled rather than after present, so it doesn't add to the input latency
+    frame_limiter.set_target_fps(background && background_fps > 0 ? background_fps : max_fps);
+    frame_limiter.wait();
+
+    if (low_latency && vk_provider != nullptr) {
+        vk_provider->await_queued_frames();
+    }
+
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             return StepResult::SDLQuit;
         }
 
-        // TODO: Other windows
-        if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-            main_window->mark_dirty();
+        // SIZE_CHANGED also covers resizes made by us or the OS, not just the user
+        if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            Window *p_window = find_window(event.window.windowID);
+
+            if (p_window != nullptr) {
+                p_window->mark_resized();
+            }
         }
     }
 
-    tick_graphics();
+    // Even with every window minimized the frame still runs, at the background rate
+    // Uploads, deferred releases and loader threads waiting on staging space all depend on it
+    if (vk_provider != nullptr) {
+        tick_graphics();
+    }
 
     return StepResult::Success;
 }
 
+//
+// Windows and render targets
+//
+Window *Engine::create_window(const std::string &title, int width, int height) {
+    if (vk_provider == nullptr || vk_provider->is_headless()) {
+        throw std::runtime_error("Windows can only be created with the standard pipeline!");
+    }
+
+    Window *p_window = new Window();
+    p_window->initialize();
+    p_window->set_title(title);
+    p_window->set_width(width);
+    p_window->set_height(height);
+    p_window->set_resizable(true);
+
+    p_window->create_render_target(this);
+
+    windows.push_back(p_window);
+    return p_window;
+}
+
+void Engine::add_render_target(Graphics::RenderTarget *p_target) {
+    if (p_target == nullptr) {
+        throw std::runtime_error("p_target was nullptr!");
+    }
+
+    render_targets.push_back(p_target);
+}
+
+void Engine::remove_render_target(Graphics::RenderTarget *p_target) {
+    render_targets.erase(std::remove(render_targets.begin(), render_targets.end(), p_target), render_targets.end());
+}
+
+const std::vector<Window*> &Engine::get_windows() const {
+    return windows;
+}
+
+//
+// Frame pacing
+//
+void Engine::set_vsync(bool vsync) {
+    if (vk_provider == nullptr) {
+        return;
+    }
+
+    vk_provider->set_vsync(vsync);
+
+    // The present mode belongs to the swapchain
+    for (Window *p_window : windows) {
+        p_window->mark_dirty();
+    }
+}
+
+void Engine::set_swapchain_images(int count) {
+    if (vk_provider == nullptr) {
+        return;
+    }
+
+    vk_provider->set_swapchain_images(static_cast<uint32_t>(count));
+
+    for (Window *p_window : windows) {
+        p_window->mark_dirty();
+    }
+}
+
+void Engine::set_max_queued_frames(int count) {
+    if (vk_provider != nullptr) {
+        vk_provider->set_max_queued_frames(static_cast<uint32_t>(count));
+    }
+}
+
+void Engine::set_max_fps(int fps) {
+    max_fps = fps;
+}
+
+void Engine::set_background_fps(int fps) {
+    background_fps = fps;
+}
+
+void Engine::set_low_latency(bool low_latency) {
+    this->low_latency = low_latency;
+}
+
 //
 // Getters
 //
@@ -25,7 +25,11 @@ SOFTWARE.
 #ifndef SAPPHIRE_ENGINE_HPP
 #define SAPPHIRE_ENGINE_HPP
 
+#include <data/frame_limiter.hpp>
+
+#include <cstdint>
 #include <string>
+#include <vector>
 
 
 #define LOG_ENGINE_INLINE(MSG) (std::cout << "[ENGINE]: " << MSG)
@@ -36,10 +40,14 @@ SOFTWARE.
 
 namespace Sapphire {
     class Window;
+    class WorkerPool;
 
     namespace Graphics {
         class VulkanProvider;
         class Pipeline;
+        class RenderTarget;
+        class WindowRenderTarget;
+        class ImageRenderTarget;
     }
 
     class Engine {
@@ -90,18 +98,74 @@ namespace Sapphire {
         Graphics::VulkanProvider *vk_provider = nullptr;
         Graphics::Pipeline *pipeline = nullptr;
 
+        // Only exists in headless mode, drawn to in place of the main window
+        Graphics::ImageRenderTarget *offscreen_target = nullptr;
+
         enum class RequestedPipeline {
             None,
-            Standard
+            Standard,
+
+            // No window, surface or swapchain, frames are drawn to offscreen_target at full speed
+            // Works on machines without a display, e.g. CI with a software Vulkan driver
+            Headless
         };
 
         // The config to initialize the engine with
         struct EngineConfig {
             RequestedPipeline graphics = RequestedPipeline::Standard;
 
+            // In headless mode, this is the size of the offscreen target
             int window_width = 1024;
             int window_height = 768;
 
+            // How many frames the CPU can record ahead of the GPU
+            int frames_in_flight = 2;
+
+            // How many frames may still be queued on the GPU when a new one starts, 0 allows frames_in_flight
+            // 1 gives the lowest latency, but the GPU idles while the CPU records
+            int max_queued_frames = 0;
+
+            // Present with FIFO, capping the frame rate to the display
+            bool vsync = false;
+
+            // Prefer an sRGB swapchain and a D32 depth format
+            bool srgb = false;
+            bool d32 = false;
+
+            // How many swapchain images to ask for, 0 picks one more than the minimum
+            int swapchain_images = 0;
+
+            // Presents from a dedicated thread, so a blocking present doesn't hold up the next frame
+            bool present_thread = false;
+
+            // How many worker threads record render targets alongside the main thread
+            // 0 records everything on the main thread, -1 uses every spare hardware thread
+            int render_threads = -1;
+
+            // Caps the frame rate on the CPU, 0 disables the limit
+            int max_fps = 0;
+
+            // The frame rate while the window is unfocused, a minimized window isn't drawn at all, 0 disables throttling
+            int background_fps = 10;
+
+            // Waits for the GPU before polling input rather than after, so frames are recorded from the freshest input
+            bool low_latency = false;
+
+            // How many frames a completely empty memory pool chunk is kept before it's released
+            int memory_pool_idle_frames = 600;
+
+            // How many KiB of memory blocks may be moved each frame to defragment the pools, 0 disables it
+            int defrag_kib_per_frame = 2048;
+
+            // How many KiB of staged uploads are submitted each frame, the rest waits for later frames, 0 disables the limit
+            int upload_kib_per_frame = 16384;
+
+            // How many KiB of per-view and per-draw constants can be written each frame
+            int uniform_ring_kib_per_frame = 1024;
+
+            // How many KiB of transient CPU memory the render path starts with, it grows if a frame needs more
+            int frame_arena_kib = 256;
+
             AppInfo app_info;
         };
 
@@ -128,12 +192,61 @@ namespace Sapphire {
         // State
         //
     private:
+        // DEBUG builds warn about heap allocations in tick_graphics after this many frames
+        static constexpr uint64_t ALLOCATION_WARMUP_FRAMES = 8;
+
+        FrameLimiter frame_limiter;
+        int max_fps = 0;
+        int background_fps = 0;
+        bool low_latency = false;
+
+        // Every window the engine draws to, main_window comes first
+        std::vector<Window*> windows;
+
+        // Targets without a window, drawn every frame alongside the windows
+        std::vector<Graphics::RenderTarget*> render_targets;
+
+        // The targets drawn this frame, kept around so building them doesn't allocate
+        std::vector<Graphics::RenderTarget*> frame_targets;
+        std::vector<Graphics::WindowRenderTarget*> frame_windows;
+
+        // Records targets in parallel, nullptr if everything is recorded on the main thread
+        WorkerPool *worker_pool = nullptr;
+
         void tick_graphics();
 
+        // Safe to call from any thread, as long as no other thread records the same target
+        void record_target(Graphics::RenderTarget *p_target);
+
+        Window *find_window(uint32_t id);
+
     public:
         // Steps the engine forward one frame
         StepResult tick();
 
+        //
+        // Windows and render targets
+        //
+
+        // Opens another window that is drawn every frame, it lives as long as the engine does
+        Window *create_window(const std::string &title, int width, int height);
+
+        // The engine doesn't take ownership, remove the target before destroying it
+        void add_render_target(Graphics::RenderTarget *p_target);
+        void remove_render_target(Graphics::RenderTarget *p_target);
+
+        const std::vector<Window*> &get_windows() const;
+
+        //
+        // Frame pacing
+        //
+        void set_vsync(bool vsync);
+        void set_swapchain_images(int count);
+        void set_max_queued_frames(int count);
+        void set_max_fps(int fps);
+        void set_background_fps(int fps);
+        void set_low_latency(bool low_latency);
+
         //
         // Getters
         //
@@ -0,0 +1,309 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "bindless_table.hpp"
+
+#include <engine.hpp>
+#include <graphics/uniform_ring.hpp>
+#include <graphics/vulkan_provider.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Sapphire;
+
+static_assert(Graphics::BindlessTable::SET_INDEX == Graphics::UniformRing::SetCount, "The bindless set must directly follow the constants sets!");
+
+Graphics::BindlessTable::BindlessTable(VulkanProvider *p_provider, uint32_t max_buffers, uint32_t max_images, uint32_t max_samplers) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider was nullptr!");
+    }
+
+    this->p_provider = p_provider;
+
+    query_capacities(max_buffers, max_images, max_samplers);
+    create_descriptors();
+}
+
+void Graphics::BindlessTable::query_capacities(uint32_t max_buffers, uint32_t max_images, uint32_t max_samplers) {
+    // Vulkan 1.0 only has the KHR entry point, which has to be loaded by hand
+    auto vkGetPhysicalDeviceProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+        vkGetInstanceProcAddr(p_provider->get_vk_instance(), "vkGetPhysicalDeviceProperties2KHR")
+    );
+
+    if (vkGetPhysicalDeviceProperties2KHR == nullptr) {
+        throw std::runtime_error("vkGetPhysicalDeviceProperties2KHR was unavailable!");
+    }
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_properties {};
+    indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2KHR properties {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties.pNext = &indexing_properties;
+
+    vkGetPhysicalDeviceProperties2KHR(p_provider->get_vk_gpu(), &properties);
+
+    // Every binding is visible to every stage, so the per-stage limits apply too
+    index_lists[BindingStorageBuffers].capacity = std::min({
+        max_buffers,
+        indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+    });
+
+    index_lists[BindingSampledImages].capacity = std::min({
+        max_images,
+        indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages
+    });
+
+    index_lists[BindingSamplers].capacity = std::min({
+        max_samplers,
+        indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers
+    });
+
+    max_buffer_range = properties.properties.limits.maxStorageBufferRange;
+}
+
+void Graphics::BindlessTable::create_descriptors() {
+    VkDevice vk_device = p_provider->get_vk_device();
+
+    const VkDescriptorType vk_types[BindingCount] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER
+    };
+
+    VkDescriptorSetLayoutBinding bindings[BindingCount] {};
+    VkDescriptorBindingFlagsEXT binding_flags[BindingCount] {};
+    VkDescriptorPoolSize pool_sizes[BindingCount] {};
+
+    for (uint32_t b = 0; b < BindingCount; b++) {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = vk_types[b];
+        bindings[b].descriptorCount = index_lists[b].capacity;
+        bindings[b].stageFlags = VK_SHADER_STAGE_ALL;
+
+        // Unused indices never have to hold a valid descriptor, and indices can be written while the set is bound
+        binding_flags[b] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+
+        pool_sizes[b].type = vk_types[b];
+        pool_sizes[b].descriptorCount = index_lists[b].capacity;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info {};
+    binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    binding_flags_info.bindingCount = BindingCount;
+    binding_flags_info.pBindingFlags = binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info {};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.pNext = &binding_flags_info;
+    layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layout_create_info.bindingCount = BindingCount;
+    layout_create_info.pBindings = bindings;
+
+    VkResult result = vkCreateDescriptorSetLayout(vk_device, &layout_create_info, nullptr, &vk_set_layout);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkCreateDescriptorSetLayout failed with error code (" << result << ")");
+        throw std::runtime_error("vkCreateDescriptorSetLayout failed! Please check the log above for more info!");
+    }
+
+    VkDescriptorPoolCreateInfo pool_create_info {};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    pool_create_info.maxSets = 1;
+    pool_create_info.poolSizeCount = BindingCount;
+    pool_create_info.pPoolSizes = pool_sizes;
+
+    result = vkCreateDescriptorPool(vk_device, &pool_create_info, nullptr, &vk_pool);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkCreateDescriptorPool failed with error code (" << result << ")");
+        throw std::runtime_error("vkCreateDescriptorPool failed! Please check the log above for more info!");
+    }
+
+    VkDescriptorSetAllocateInfo set_alloc_info {};
+    set_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_alloc_info.descriptorPool = vk_pool;
+    set_alloc_info.descriptorSetCount = 1;
+    set_alloc_info.pSetLayouts = &vk_set_layout;
+
+    result = vkAllocateDescriptorSets(vk_device, &set_alloc_info, &vk_set);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkAllocateDescriptorSets failed with error code (" << result << ")");
+        throw std::runtime_error("vkAllocateDescriptorSets failed! Please check the log above for more info!");
+    }
+}
+
+uint32_t Graphics::BindlessTable::alloc_index(Binding binding) {
+    IndexList &list = index_lists[binding];
+
+    if (!list.free_indices.empty()) {
+        uint32_t index = list.free_indices.back();
+        list.free_indices.pop_back();
+
+        return index;
+    }
+
+    if (list.next >= list.capacity) {
+        return INVALID_INDEX;
+    }
+
+    return list.next++;
+}
+
+void Graphics::BindlessTable::free_index(Binding binding, uint32_t index) {
+    if (index == INVALID_INDEX) {
+        return;
+    }
+
+    p_provider->enqueue_release([this, binding, index](VulkanProvider*) {
+        std::lock_guard<std::mutex> lock(mutex);
+        index_lists[binding].free_indices.push_back(index);
+    });
+}
+
+void Graphics::BindlessTable::write_buffer(uint32_t index, VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range) {
+    VkDescriptorBufferInfo buffer_info {};
+    buffer_info.buffer = vk_buffer;
+    buffer_info.offset = offset;
+    buffer_info.range = std::min(range, max_buffer_range);
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = vk_set;
+    write.dstBinding = BindingStorageBuffers;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(p_provider->get_vk_device(), 1, &write, 0, nullptr);
+}
+
+uint32_t Graphics::BindlessTable::register_buffer(VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index = alloc_index(BindingStorageBuffers);
+
+    if (index != INVALID_INDEX) {
+        write_buffer(index, vk_buffer, offset, range);
+    }
+
+    return index;
+}
+
+uint32_t Graphics::BindlessTable::register_image(VkImageView vk_image_view, VkImageLayout vk_layout) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index = alloc_index(BindingSampledImages);
+
+    if (index == INVALID_INDEX) {
+        return index;
+    }
+
+    VkDescriptorImageInfo image_info {};
+    image_info.imageView = vk_image_view;
+    image_info.imageLayout = vk_layout;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = vk_set;
+    write.dstBinding = BindingSampledImages;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(p_provider->get_vk_device(), 1, &write, 0, nullptr);
+
+    return index;
+}
+
+uint32_t Graphics::BindlessTable::register_sampler(VkSampler vk_sampler) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index = alloc_index(BindingSamplers);
+
+    if (index == INVALID_INDEX) {
+        return index;
+    }
+
+    VkDescriptorImageInfo image_info {};
+    image_info.sampler = vk_sampler;
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = vk_set;
+    write.dstBinding = BindingSamplers;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo = &image_info;
+
+    vkUpdateDescriptorSets(p_provider->get_vk_device(), 1, &write, 0, nullptr);
+
+    return index;
+}
+
+void Graphics::BindlessTable::update_buffer(uint32_t index, VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range) {
+    if (index == INVALID_INDEX) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    write_buffer(index, vk_buffer, offset, range);
+}
+
+void Graphics::BindlessTable::release_buffer(uint32_t index) {
+    free_index(BindingStorageBuffers, index);
+}
+
+void Graphics::BindlessTable::release_image(uint32_t index) {
+    free_index(BindingSampledImages, index);
+}
+
+void Graphics::BindlessTable::release_sampler(uint32_t index) {
+    free_index(BindingSamplers, index);
+}
+
+void Graphics::BindlessTable::bind(VkCommandBuffer vk_cmd_buffer, VkPipelineLayout vk_pipeline_layout) {
+    if (vk_cmd_buffer == nullptr) {
+        throw std::runtime_error("vk_cmd_buffer was nullptr");
+    }
+
+    vkCmdBindDescriptorSets(vk_cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_pipeline_layout, SET_INDEX, 1, &vk_set, 0, nullptr);
+}
+
+VkDescriptorSetLayout Graphics::BindlessTable::get_vk_set_layout() {
+    return vk_set_layout;
+}
+
+uint32_t Graphics::BindlessTable::get_capacity(Binding binding) const {
+    return index_lists[binding].capacity;
+}
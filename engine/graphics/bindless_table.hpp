@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_BINDLESS_TABLE_HPP
+#define SAPPHIRE_BINDLESS_TABLE_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Sapphire::Graphics {
+    class VulkanProvider;
+
+    // A single global descriptor set of large, partially bound arrays, see sapphire_bindless.glsl
+    // Resources register once and keep their index until they're released, shaders pick them by index from push constants or instance data
+    // The set is bound once per command buffer, so drawing never has to bind descriptor sets again
+    // Requires VK_EXT_descriptor_indexing, the provider leaves the table out if the GPU lacks it
+    // Safe to call from any thread
+    class BindlessTable {
+    public:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        // The set index of the table in the shared pipeline layout, right after the uniform ring's constants sets
+        static constexpr uint32_t SET_INDEX = 2;
+
+        enum Binding : uint32_t {
+            BindingStorageBuffers = 0,
+            BindingSampledImages = 1,
+            BindingSamplers = 2,
+
+            BindingCount = 3
+        };
+
+    protected:
+        // Indices are handed out from the top until the array is full, released ones are reused first
+        struct IndexList {
+            uint32_t capacity = 0;
+            uint32_t next = 0;
+            std::vector<uint32_t> free_indices;
+        };
+
+        VulkanProvider *p_provider = nullptr;
+
+        VkDescriptorSetLayout vk_set_layout = nullptr;
+        VkDescriptorPool vk_pool = nullptr;
+        VkDescriptorSet vk_set = nullptr;
+
+        VkDeviceSize max_buffer_range = 0;
+
+        // Guards the index lists and descriptor writes, the set must not be written from two threads at once
+        std::mutex mutex;
+        IndexList index_lists[BindingCount];
+
+        void query_capacities(uint32_t max_buffers, uint32_t max_images, uint32_t max_samplers);
+        void create_descriptors();
+
+        uint32_t alloc_index(Binding binding);
+
+        // The index is only reused once the frames in flight that may be reading it have finished
+        void free_index(Binding binding, uint32_t index);
+
+        void write_buffer(uint32_t index, VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range);
+
+    public:
+        BindlessTable() = delete;
+
+        // The capacities are clamped to what the GPU supports
+        BindlessTable(VulkanProvider *p_provider, uint32_t max_buffers, uint32_t max_images, uint32_t max_samplers);
+
+        BindlessTable(const BindlessTable&) = delete;
+        BindlessTable& operator=(const BindlessTable&) = delete;
+
+        // Returns INVALID_INDEX if the array is full
+        uint32_t register_buffer(VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range);
+        uint32_t register_image(VkImageView vk_image_view, VkImageLayout vk_layout);
+        uint32_t register_sampler(VkSampler vk_sampler);
+
+        // Points an index at a new range, used when defragmentation moves a block
+        void update_buffer(uint32_t index, VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range);
+
+        void release_buffer(uint32_t index);
+        void release_image(uint32_t index);
+        void release_sampler(uint32_t index);
+
+        // Binds the table at SET_INDEX, the layout must be the provider's shared pipeline layout
+        void bind(VkCommandBuffer vk_cmd_buffer, VkPipelineLayout vk_pipeline_layout);
+
+        VkDescriptorSetLayout get_vk_set_layout();
+
+        [[nodiscard]]
+        uint32_t get_capacity(Binding binding) const;
+    };
+}
+
+#endif//SAPPHIRE_BINDLESS_TABLE_HPP
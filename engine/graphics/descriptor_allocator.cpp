@@ -0,0 +1,466 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "descriptor_allocator.hpp"
+
+#include <engine.hpp>
+#include <graphics/vulkan_provider.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace Sapphire;
+
+namespace {
+    // How many descriptors of each type a pool holds per set
+    // TODO: Tune these once materials exist
+    struct PoolRatio {
+        VkDescriptorType vk_type;
+        float ratio;
+    };
+
+    const PoolRatio POOL_RATIOS[] = {
+            {VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+            {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f}
+    };
+
+    void hash_combine(size_t &seed, size_t value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    template<typename T>
+    void hash_combine(size_t &seed, const T &value) {
+        hash_combine(seed, std::hash<T>{}(value));
+    }
+
+    bool is_buffer_descriptor(VkDescriptorType vk_type) {
+        switch (vk_type) {
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool is_image_descriptor(VkDescriptorType vk_type) {
+        switch (vk_type) {
+            case VK_DESCRIPTOR_TYPE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+}
+
+//
+// DescriptorAllocator
+//
+
+Graphics::DescriptorAllocator::DescriptorAllocator(VkDevice vk_device, uint32_t initial_sets, VkDescriptorPoolCreateFlags vk_pool_flags) {
+    if (vk_device == nullptr) {
+        throw std::runtime_error("vk_device was nullptr!");
+    }
+
+    if (initial_sets == 0) {
+        throw std::runtime_error("initial_sets was 0!");
+    }
+
+    this->vk_device = vk_device;
+    this->vk_pool_flags = vk_pool_flags;
+    this->next_pool_sets = std::min(initial_sets, MAX_SETS_PER_POOL);
+}
+
+VkDescriptorPool Graphics::DescriptorAllocator::create_pool() {
+    VkDescriptorPoolSize pool_sizes[std::size(POOL_RATIOS)];
+
+    for (size_t p = 0; p < std::size(POOL_RATIOS); p++) {
+        pool_sizes[p].type = POOL_RATIOS[p].vk_type;
+        pool_sizes[p].descriptorCount = std::max(1u, static_cast<uint32_t>(POOL_RATIOS[p].ratio * next_pool_sets));
+    }
+
+    VkDescriptorPoolCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    create_info.poolSizeCount = static_cast<uint32_t>(std::size(pool_sizes));
+    create_info.pPoolSizes = pool_sizes;
+    create_info.maxSets = next_pool_sets;
+    create_info.flags = vk_pool_flags;
+
+    VkDescriptorPool vk_pool = nullptr;
+    VkResult result = vkCreateDescriptorPool(vk_device, &create_info, nullptr, &vk_pool);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkCreateDescriptorPool failed with error code (" << result << ")");
+        throw std::runtime_error("vkCreateDescriptorPool failed! Please check the log above for more info!");
+    }
+
+    next_pool_sets = std::min(next_pool_sets * 2, MAX_SETS_PER_POOL);
+    vk_pools.push_back(vk_pool);
+
+    return vk_pool;
+}
+
+VkDescriptorSet Graphics::DescriptorAllocator::allocate(VkDescriptorSetLayout vk_layout, VkDescriptorPool *p_vk_pool) {
+    if (vk_layout == nullptr) {
+        throw std::runtime_error("vk_layout was nullptr!");
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &vk_layout;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Pools we've moved past are full, so only the current one (and any after it) are tried
+    while (true) {
+        bool fresh_pool = current_pool >= vk_pools.size();
+        alloc_info.descriptorPool = fresh_pool ? create_pool() : vk_pools[current_pool];
+
+        VkDescriptorSet vk_set = nullptr;
+        VkResult result = vkAllocateDescriptorSets(vk_device, &alloc_info, &vk_set);
+
+        if (result == VK_SUCCESS) {
+            if (p_vk_pool != nullptr) {
+                *p_vk_pool = alloc_info.descriptorPool;
+            }
+
+            return vk_set;
+        }
+
+        // A set that doesn't fit an empty pool never will
+        bool pool_full = result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
+
+        if (!pool_full || fresh_pool) {
+            LOG_GRAPHICS("Error: vkAllocateDescriptorSets failed with error code (" << result << ")");
+            throw std::runtime_error("vkAllocateDescriptorSets failed! Please check the log above for more info!");
+        }
+
+        current_pool++;
+    }
+}
+
+void Graphics::DescriptorAllocator::free(VkDescriptorPool vk_pool, VkDescriptorSet vk_set) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    vkFreeDescriptorSets(vk_device, vk_pool, 1, &vk_set);
+}
+
+void Graphics::DescriptorAllocator::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (VkDescriptorPool vk_pool : vk_pools) {
+        vkResetDescriptorPool(vk_device, vk_pool, 0);
+    }
+
+    current_pool = 0;
+}
+
+void Graphics::DescriptorAllocator::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (VkDescriptorPool vk_pool : vk_pools) {
+        vkDestroyDescriptorPool(vk_device, vk_pool, nullptr);
+    }
+
+    vk_pools.clear();
+    current_pool = 0;
+}
+
+size_t Graphics::DescriptorAllocator::get_pool_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return vk_pools.size();
+}
+
+//
+// DescriptorLayoutCache
+//
+
+bool Graphics::DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey &rhs) const {
+    if (bindings.size() != rhs.bindings.size()) {
+        return false;
+    }
+
+    for (size_t b = 0; b < bindings.size(); b++) {
+        const VkDescriptorSetLayoutBinding &lhs_binding = bindings[b];
+        const VkDescriptorSetLayoutBinding &rhs_binding = rhs.bindings[b];
+
+        if (lhs_binding.binding != rhs_binding.binding
+            || lhs_binding.descriptorType != rhs_binding.descriptorType
+            || lhs_binding.descriptorCount != rhs_binding.descriptorCount
+            || lhs_binding.stageFlags != rhs_binding.stageFlags
+            || lhs_binding.pImmutableSamplers != rhs_binding.pImmutableSamplers) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t Graphics::DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const {
+    size_t hash = key.bindings.size();
+
+    for (const VkDescriptorSetLayoutBinding &binding : key.bindings) {
+        hash_combine(hash, binding.binding);
+        hash_combine(hash, static_cast<uint32_t>(binding.descriptorType));
+        hash_combine(hash, binding.descriptorCount);
+        hash_combine(hash, binding.stageFlags);
+        hash_combine(hash, binding.pImmutableSamplers);
+    }
+
+    return hash;
+}
+
+Graphics::DescriptorLayoutCache::DescriptorLayoutCache(VkDevice vk_device) {
+    if (vk_device == nullptr) {
+        throw std::runtime_error("vk_device was nullptr!");
+    }
+
+    this->vk_device = vk_device;
+}
+
+VkDescriptorSetLayout Graphics::DescriptorLayoutCache::get_layout(const VkDescriptorSetLayoutBinding *p_bindings, uint32_t count) {
+    if (p_bindings == nullptr && count > 0) {
+        throw std::runtime_error("p_bindings was nullptr!");
+    }
+
+    LayoutKey key {};
+    key.bindings.assign(p_bindings, p_bindings + count);
+
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding &lhs, const VkDescriptorSetLayoutBinding &rhs) {
+        return lhs.binding < rhs.binding;
+    });
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto cached = vk_layouts.find(key);
+
+    if (cached != vk_layouts.end()) {
+        return cached->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    create_info.bindingCount = static_cast<uint32_t>(key.bindings.size());
+    create_info.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout vk_layout = nullptr;
+    VkResult result = vkCreateDescriptorSetLayout(vk_device, &create_info, nullptr, &vk_layout);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkCreateDescriptorSetLayout failed with error code (" << result << ")");
+        throw std::runtime_error("vkCreateDescriptorSetLayout failed! Please check the log above for more info!");
+    }
+
+    vk_layouts.emplace(std::move(key), vk_layout);
+
+    return vk_layout;
+}
+
+void Graphics::DescriptorLayoutCache::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& [key, vk_layout] : vk_layouts) {
+        vkDestroyDescriptorSetLayout(vk_device, vk_layout, nullptr);
+    }
+
+    vk_layouts.clear();
+}
+
+size_t Graphics::DescriptorLayoutCache::get_layout_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return vk_layouts.size();
+}
+
+//
+// DescriptorSetCache
+//
+
+bool Graphics::DescriptorWrite::operator==(const DescriptorWrite &rhs) const {
+    return binding == rhs.binding
+        && vk_type == rhs.vk_type
+        && vk_buffer_info.buffer == rhs.vk_buffer_info.buffer
+        && vk_buffer_info.offset == rhs.vk_buffer_info.offset
+        && vk_buffer_info.range == rhs.vk_buffer_info.range
+        && vk_image_info.sampler == rhs.vk_image_info.sampler
+        && vk_image_info.imageView == rhs.vk_image_info.imageView
+        && vk_image_info.imageLayout == rhs.vk_image_info.imageLayout;
+}
+
+Graphics::DescriptorSetCache::DescriptorSetCache(VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider was nullptr!");
+    }
+
+    this->p_provider = p_provider;
+
+    // Evicted sets are freed one by one, so these pools need the free bit
+    da_sets = new DescriptorAllocator(p_provider->get_vk_device(), 64, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+}
+
+size_t Graphics::DescriptorSetCache::hash_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count) {
+    size_t hash = 0;
+    hash_combine(hash, vk_layout);
+
+    for (uint32_t w = 0; w < count; w++) {
+        const DescriptorWrite &write = p_writes[w];
+
+        hash_combine(hash, write.binding);
+        hash_combine(hash, static_cast<uint32_t>(write.vk_type));
+        hash_combine(hash, write.vk_buffer_info.buffer);
+        hash_combine(hash, write.vk_buffer_info.offset);
+        hash_combine(hash, write.vk_buffer_info.range);
+        hash_combine(hash, write.vk_image_info.sampler);
+        hash_combine(hash, write.vk_image_info.imageView);
+        hash_combine(hash, static_cast<uint32_t>(write.vk_image_info.imageLayout));
+    }
+
+    return hash;
+}
+
+VkDescriptorSet Graphics::DescriptorSetCache::create_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count, VkDescriptorPool *p_vk_pool) {
+    VkDescriptorSet vk_set = da_sets->allocate(vk_layout, p_vk_pool);
+
+    std::vector<VkWriteDescriptorSet> vk_writes(count);
+
+    for (uint32_t w = 0; w < count; w++) {
+        const DescriptorWrite &write = p_writes[w];
+        VkWriteDescriptorSet &vk_write = vk_writes[w];
+
+        vk_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        vk_write.dstSet = vk_set;
+        vk_write.dstBinding = write.binding;
+        vk_write.descriptorCount = 1;
+        vk_write.descriptorType = write.vk_type;
+
+        if (is_buffer_descriptor(write.vk_type)) {
+            vk_write.pBufferInfo = &write.vk_buffer_info;
+        } else if (is_image_descriptor(write.vk_type)) {
+            vk_write.pImageInfo = &write.vk_image_info;
+        } else {
+            // TODO: Texel buffers
+            throw std::runtime_error("Unsupported descriptor type for a cached set!");
+        }
+    }
+
+    vkUpdateDescriptorSets(p_provider->get_vk_device(), count, vk_writes.data(), 0, nullptr);
+
+    return vk_set;
+}
+
+VkDescriptorSet Graphics::DescriptorSetCache::get_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count) {
+    if (p_writes == nullptr && count > 0) {
+        throw std::runtime_error("p_writes was nullptr!");
+    }
+
+    size_t hash = hash_set(vk_layout, p_writes, count);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<CachedSet> &bucket = cached_sets[hash];
+
+    for (const CachedSet &cached : bucket) {
+        if (cached.vk_layout == vk_layout && std::equal(cached.writes.begin(), cached.writes.end(), p_writes, p_writes + count)) {
+            return cached.vk_set;
+        }
+    }
+
+    CachedSet cached {};
+    cached.vk_layout = vk_layout;
+    cached.writes.assign(p_writes, p_writes + count);
+    cached.vk_set = create_set(vk_layout, p_writes, count, &cached.vk_pool);
+
+    bucket.push_back(std::move(cached));
+    set_count++;
+
+    return bucket.back().vk_set;
+}
+
+void Graphics::DescriptorSetCache::evict_buffer(VkBuffer vk_buffer) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto bucket = cached_sets.begin(); bucket != cached_sets.end();) {
+        std::vector<CachedSet> &sets = bucket->second;
+
+        // Kept sets end up in front, unlike remove_if the evicted ones are still intact at the back
+        auto evicted = std::stable_partition(sets.begin(), sets.end(), [vk_buffer](const CachedSet &cached) {
+            return std::none_of(cached.writes.begin(), cached.writes.end(), [vk_buffer](const DescriptorWrite &write) {
+                return is_buffer_descriptor(write.vk_type) && write.vk_buffer_info.buffer == vk_buffer;
+            });
+        });
+
+        // Frames in flight may still be bound to these sets
+        // Other threads may be allocating from the same pool by the time this runs, so it goes through the allocator's lock
+        for (auto set = evicted; set != sets.end(); set++) {
+            p_provider->enqueue_release([da_sets = da_sets, vk_pool = set->vk_pool, vk_set = set->vk_set](VulkanProvider *) {
+                da_sets->free(vk_pool, vk_set);
+            });
+        }
+
+        set_count -= std::distance(evicted, sets.end());
+        sets.erase(evicted, sets.end());
+
+        if (sets.empty()) {
+            bucket = cached_sets.erase(bucket);
+        } else {
+            bucket++;
+        }
+    }
+}
+
+void Graphics::DescriptorSetCache::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    cached_sets.clear();
+    set_count = 0;
+
+    da_sets->release();
+}
+
+size_t Graphics::DescriptorSetCache::get_set_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return set_count;
+}
@@ -0,0 +1,172 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_DESCRIPTOR_ALLOCATOR_HPP
+#define SAPPHIRE_DESCRIPTOR_ALLOCATOR_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Sapphire::Graphics {
+    class VulkanProvider;
+
+    // Hands out descriptor sets from a growing list of pools
+    // When the current pool runs dry the next one is used (or created), each new pool holds twice the sets of the last
+    // reset() gives every set back at once but keeps the pools around, so a steady frame never creates any
+    // Safe to call from any thread, descriptor pools are externally synchronized so every call takes the mutex
+    class DescriptorAllocator {
+    protected:
+        VkDevice vk_device = nullptr;
+        VkDescriptorPoolCreateFlags vk_pool_flags = 0;
+
+        std::mutex mutex;
+
+        std::vector<VkDescriptorPool> vk_pools;
+        size_t current_pool = 0;
+        uint32_t next_pool_sets = 0;
+
+        const uint32_t MAX_SETS_PER_POOL = 4096;
+
+        VkDescriptorPool create_pool();
+
+    public:
+        DescriptorAllocator() = delete;
+        DescriptorAllocator(VkDevice vk_device, uint32_t initial_sets, VkDescriptorPoolCreateFlags vk_pool_flags = 0);
+
+        DescriptorAllocator(const DescriptorAllocator&) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+        // p_vk_pool receives the pool the set came from, needed to free it if the pools allow that
+        VkDescriptorSet allocate(VkDescriptorSetLayout vk_layout, VkDescriptorPool *p_vk_pool = nullptr);
+
+        // Gives a single set back, the pools must have been created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+        void free(VkDescriptorPool vk_pool, VkDescriptorSet vk_set);
+
+        // Every set allocated so far becomes invalid, the GPU must be done with all of them
+        void reset();
+
+        // Destroys every pool
+        void release();
+
+        [[nodiscard]]
+        size_t get_pool_count();
+    };
+
+    // Deduplicates descriptor set layouts, identical binding lists always map to the same VkDescriptorSetLayout
+    // Layouts live until release(), which makes comparing them by handle valid for the provider's whole lifetime
+    // Safe to call from any thread
+    class DescriptorLayoutCache {
+    protected:
+        struct LayoutKey {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+            bool operator==(const LayoutKey &rhs) const;
+        };
+
+        struct LayoutKeyHash {
+            size_t operator()(const LayoutKey &key) const;
+        };
+
+        VkDevice vk_device = nullptr;
+
+        std::mutex mutex;
+        std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> vk_layouts;
+
+    public:
+        DescriptorLayoutCache() = delete;
+        explicit DescriptorLayoutCache(VkDevice vk_device);
+
+        DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+        DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+        // The order of the bindings doesn't matter
+        VkDescriptorSetLayout get_layout(const VkDescriptorSetLayoutBinding *p_bindings, uint32_t count);
+
+        void release();
+
+        [[nodiscard]]
+        size_t get_layout_count();
+    };
+
+    // A single descriptor of a cached set, buffer_info is used by buffer types and image_info by image types
+    struct DescriptorWrite {
+        uint32_t binding = 0;
+        VkDescriptorType vk_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        VkDescriptorBufferInfo vk_buffer_info {};
+        VkDescriptorImageInfo vk_image_info {};
+
+        bool operator==(const DescriptorWrite &rhs) const;
+    };
+
+    // Long-lived descriptor sets, cached by a hash of their layout and writes
+    // Asking for the same bindings twice returns the same set, so materials sharing resources share sets too
+    // Sets are written once and never updated, evict_buffer() drops every set that points into a buffer before it's destroyed
+    // Safe to call from any thread
+    class DescriptorSetCache {
+    protected:
+        struct CachedSet {
+            VkDescriptorSetLayout vk_layout;
+            std::vector<DescriptorWrite> writes;
+            VkDescriptorSet vk_set;
+            VkDescriptorPool vk_pool;
+        };
+
+        VulkanProvider *p_provider = nullptr;
+        DescriptorAllocator *da_sets = nullptr;
+
+        std::mutex mutex;
+
+        // Keyed by hash, collisions share a bucket so a lookup never has to build a key
+        std::unordered_map<size_t, std::vector<CachedSet>> cached_sets;
+        size_t set_count = 0;
+
+        static size_t hash_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count);
+
+        VkDescriptorSet create_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count, VkDescriptorPool *p_vk_pool);
+
+    public:
+        DescriptorSetCache() = delete;
+        explicit DescriptorSetCache(VulkanProvider *p_provider);
+
+        DescriptorSetCache(const DescriptorSetCache&) = delete;
+        DescriptorSetCache& operator=(const DescriptorSetCache&) = delete;
+
+        // Returns the cached set for these writes, allocating and writing it the first time
+        // Every binding is a single descriptor, the writes must be in the same order every time to hit the cache
+        VkDescriptorSet get_set(VkDescriptorSetLayout vk_layout, const DescriptorWrite *p_writes, uint32_t count);
+
+        // Forgets every set that references vk_buffer, the sets themselves are freed once the frames in flight have finished
+        void evict_buffer(VkBuffer vk_buffer);
+
+        void release();
+
+        [[nodiscard]]
+        size_t get_set_count();
+    };
+}
+
+#endif//SAPPHIRE_DESCRIPTOR_ALLOCATOR_HPP
@@ -25,21 +25,32 @@ SOFTWARE.
 #include "memory_block.hpp"
 
 #include <engine.hpp>
+#include <graphics/descriptor_allocator.hpp>
 #include <graphics/vulkan_provider.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
 
 using namespace Sapphire;
 
 //
 // MemoryBlock
 //
-Graphics::MemoryBlock::MemoryBlock(size_t chunk_index, VkBuffer vk_parent_buffer, VmaVirtualAllocation vma_valloc, VkDeviceSize vk_offset) {
+Graphics::MemoryBlock::MemoryBlock(MemoryPool *p_pool, size_t chunk_index, VkBuffer vk_parent_buffer, VmaVirtualAllocation vma_valloc, VkDeviceSize vk_offset, VkDeviceSize size) {
+    this->p_pool = p_pool;
     this->chunk_index = chunk_index;
     this->vk_parent_buffer = vk_parent_buffer;
     this->vma_valloc = vma_valloc;
     this->vk_offset = vk_offset;
+    this->size = size;
+}
+
+Graphics::MemoryPool *Graphics::MemoryBlock::get_pool() {
+    return p_pool;
 }
 
 VkBuffer Graphics::MemoryBlock::get_vk_buffer() {
@@ -50,64 +61,563 @@ VkDeviceSize Graphics::MemoryBlock::get_vk_offset() {
     return vk_offset;
 }
 
+VkDeviceSize Graphics::MemoryBlock::get_size() {
+    return size;
+}
+
 size_t Graphics::MemoryBlock::get_chunk_index() {
     return chunk_index;
 }
 
+VkDeviceAddress Graphics::MemoryBlock::get_vk_address() const {
+    if (vk_parent_address == 0) {
+        return 0;
+    }
+
+    return vk_parent_address + vk_offset;
+}
+
+uint32_t Graphics::MemoryBlock::get_bindless_index() const {
+    return bindless_index;
+}
+
 //
 // MemoryPoolChunk
 //
-std::shared_ptr<Graphics::MemoryBlock> Graphics::MemoryPoolChunk::try_alloc(size_t size) {
+bool Graphics::MemoryPoolChunk::try_alloc_range(VkDeviceSize size, VmaVirtualAllocation &vma_valloc, VkDeviceSize &offset, VkDeviceSize alignment) {
+    if (vma_vblock == nullptr || evacuating || size > this->size) {
+        return false;
+    }
+
     VmaVirtualAllocationCreateInfo valloc_create_info {};
     valloc_create_info.size = size;
+    valloc_create_info.alignment = alignment;
 
-    VmaVirtualAllocation allocation;
-    VkDeviceSize offset;
-    VkResult result = vmaVirtualAllocate(vma_vblock, &valloc_create_info, &allocation, &offset);
+    VkResult result = vmaVirtualAllocate(vma_vblock, &valloc_create_info, &vma_valloc, &offset);
+
+    // VMA reports a full block as VK_ERROR_OUT_OF_DEVICE_MEMORY, the pool will try the next chunk
+    if (result != VK_SUCCESS) {
+        return false;
+    }
+
+    alloc_count++;
+    used_bytes += size;
+
+    return true;
+}
+
+// How scattered the free space is, 0 when it is all one range
+static float fragmentation_ratio(VkDeviceSize free_bytes, VkDeviceSize largest_free_range) {
+    if (free_bytes == 0) {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(largest_free_range) / static_cast<float>(free_bytes);
+}
+
+//
+// MemorySlabClass
+//
+Graphics::MemorySlabClass::MemorySlabClass(VkDeviceSize slot_size, VkDeviceSize slab_size) {
+    this->slot_size = slot_size;
+    this->slots_per_slab = static_cast<uint32_t>(slab_size / slot_size);
+
+    if (slots_per_slab == 0 || slots_per_slab > (1u << SLOT_BITS)) {
+        throw std::runtime_error("Invalid slab layout!");
+    }
+
+    slabs = std::make_unique<std::atomic<Slab*>[]>(MAX_SLABS);
+}
+
+Graphics::MemorySlabClass::~MemorySlabClass() {
+    for (uint32_t s = 0; s < slab_count; s++) {
+        delete slabs[s].load();
+    }
+}
+
+Graphics::MemorySlabClass::Slab *Graphics::MemorySlabClass::get_slab(uint32_t slot_id) const {
+    return slabs[(slot_id - 1) >> SLOT_BITS].load(std::memory_order_acquire);
+}
+
+bool Graphics::MemorySlabClass::pop(uint32_t &slot_id) {
+    const uint32_t slot_mask = (1u << SLOT_BITS) - 1;
+    uint64_t head = free_head.load(std::memory_order_acquire);
+
+    while (true) {
+        uint32_t top = static_cast<uint32_t>(head);
+
+        if (top == NO_SLOT) {
+            return false;
+        }
+
+        // If another thread takes this slot first, the CAS fails and we try again with the new head
+        uint32_t next = get_slab(top)->next[(top - 1) & slot_mask].load(std::memory_order_relaxed);
+        uint64_t new_head = ((head >> 32) + 1) << 32 | next;
+
+        if (free_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
+            get_slab(top)->used_slots.fetch_add(1, std::memory_order_relaxed);
+
+            slot_id = top;
+            return true;
+        }
+    }
+}
+
+void Graphics::MemorySlabClass::push(uint32_t slot_id) {
+    const uint32_t slot_mask = (1u << SLOT_BITS) - 1;
+    Slab *p_slab = get_slab(slot_id);
+    std::atomic<uint32_t> &next = p_slab->next[(slot_id - 1) & slot_mask];
+
+    p_slab->used_slots.fetch_sub(1, std::memory_order_relaxed);
+
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+
+    do {
+        next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | slot_id;
+    } while (!free_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool Graphics::MemorySlabClass::add_slab(size_t chunk_index, VkBuffer vk_buffer, VkDeviceAddress vk_chunk_address, VkDeviceSize offset) {
+    uint32_t slab_index = slab_count;
+
+    if (slab_index >= MAX_SLABS) {
+        return false;
+    }
+
+    auto p_slab = new Slab {chunk_index, vk_buffer, vk_chunk_address, offset, std::make_unique<std::atomic<uint32_t>[]>(slots_per_slab)};
+
+    slabs[slab_index].store(p_slab, std::memory_order_release);
+    slab_count = slab_index + 1;
+
+    // Chain the slots together, then splice the whole chain onto the free list at once
+    uint32_t first = (slab_index << SLOT_BITS) + 1;
+
+    for (uint32_t s = 0; s + 1 < slots_per_slab; s++) {
+        p_slab->next[s].store(first + s + 1, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> &last_next = p_slab->next[slots_per_slab - 1];
+
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+
+    do {
+        last_next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | first;
+    } while (!free_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+
+    return true;
+}
 
-    // TODO: Locate which result enum corresponds to out of memory (to expand the pool)
+VkBuffer Graphics::MemorySlabClass::get_vk_buffer(uint32_t slot_id) const {
+    return get_slab(slot_id)->vk_buffer;
+}
+
+VkDeviceAddress Graphics::MemorySlabClass::get_vk_chunk_address(uint32_t slot_id) const {
+    return get_slab(slot_id)->vk_chunk_address;
+}
+
+VkDeviceSize Graphics::MemorySlabClass::get_vk_offset(uint32_t slot_id) const {
+    const uint32_t slot_mask = (1u << SLOT_BITS) - 1;
+    return get_slab(slot_id)->offset + ((slot_id - 1) & slot_mask) * slot_size;
+}
 
-    return std::make_shared<MemoryBlock>(chunk_index, vk_buffer, allocation, offset);
+size_t Graphics::MemorySlabClass::get_chunk_index(uint32_t slot_id) const {
+    return get_slab(slot_id)->chunk_index;
 }
 
 //
 // MemoryPool
 //
-Graphics::MemoryPool::MemoryPool(Graphics::VulkanProvider *p_provider, size_t size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags) {
-    this->size = size;
+Graphics::MemoryPool::MemoryPool(Graphics::VulkanProvider *p_provider, size_t min_chunk_size, size_t max_chunk_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkMemoryPropertyFlags required_properties) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider was nullptr!");
+    }
+
+    this->p_provider = p_provider;
+    this->next_chunk_size = min_chunk_size;
+    this->max_chunk_size = std::max(min_chunk_size, max_chunk_size);
     this->usage = usage;
     this->flags = flags;
+    this->required_properties = required_properties;
+
+    // Both limits are at most 256 bytes, which SLAB_ALIGNMENT covers
+    if (usage & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(p_provider->get_vk_gpu(), &properties);
+
+        if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+            block_alignment = std::max(block_alignment, properties.limits.minStorageBufferOffsetAlignment);
+        }
+
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+            block_alignment = std::max(block_alignment, properties.limits.minUniformBufferOffsetAlignment);
+        }
+    }
+
+    for (VkDeviceSize slot_size = SLAB_MIN_SLOT; slot_size <= SLAB_MAX_SLOT; slot_size *= 2) {
+        slab_classes.push_back(std::make_unique<MemorySlabClass>(slot_size, SLAB_SIZE));
+    }
+}
+
+void Graphics::MemoryPool::alloc_range(VkDeviceSize size, VkDeviceSize alignment, size_t &chunk_index, VmaVirtualAllocation &vma_valloc, VkDeviceSize &offset) {
+    for (auto& chunk : chunks) {
+        if (chunk.try_alloc_range(size, vma_valloc, offset, alignment)) {
+            chunk_index = chunk.chunk_index;
+            return;
+        }
+    }
+
+    // Nothing fits, so grow the pool
+    // Oversized allocations get a chunk of exactly their size without affecting the growth curve
+    size_t chunk_size = next_chunk_size;
+
+    if (size > max_chunk_size) {
+        chunk_size = size;
+    } else {
+        while (chunk_size < size) {
+            chunk_size = std::min(chunk_size * 2, max_chunk_size);
+        }
+
+        next_chunk_size = std::min(chunk_size * 2, max_chunk_size);
+    }
+
+    chunk_index = push_chunk(chunk_size);
+
+    if (!chunks[chunk_index].try_alloc_range(size, vma_valloc, offset, alignment)) {
+        throw std::runtime_error("Unable to allocate memory!!!");
+    }
+}
+
+Graphics::MemoryBlockHandle Graphics::MemoryPool::alloc_slot(size_t size) {
+    size_t class_index = 0;
+
+    // Slots are only aligned to their own size (up to SLAB_ALIGNMENT), so small blocks of uniform / storage pools use a class of at least block_alignment
+    VkDeviceSize slot_size = std::max<VkDeviceSize>(size, block_alignment);
+
+    while ((SLAB_MIN_SLOT << class_index) < slot_size) {
+        class_index++;
+    }
+
+    MemorySlabClass& slab_class = *slab_classes[class_index];
+    uint32_t slot_id;
+
+    // The fast path, only an empty class has to take the lock to grow
+    if (!slab_class.pop(slot_id)) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Another thread may have grown the class while we were waiting
+        while (!slab_class.pop(slot_id)) {
+            if (slab_class.get_slab_count() >= MemorySlabClass::MAX_SLABS) {
+                return {};
+            }
+
+            size_t chunk_index;
+            VmaVirtualAllocation vma_valloc;
+            VkDeviceSize offset;
+
+            alloc_range(SLAB_SIZE, SLAB_ALIGNMENT, chunk_index, vma_valloc, offset);
+
+            chunks[chunk_index].slab_count++;
+            slab_class.add_slab(chunk_index, chunks[chunk_index].vk_buffer, chunks[chunk_index].vk_address, offset);
+        }
+    }
+
+    ResourceTable<MemoryBlock> *p_table = p_provider->get_memory_block_table();
+
+    MemoryBlockHandle handle = p_table->create(this, slab_class.get_chunk_index(slot_id), slab_class.get_vk_buffer(slot_id), nullptr, slab_class.get_vk_offset(slot_id), size);
+
+    MemoryBlock *p_block = p_table->get(handle);
+    p_block->handle = handle;
+    p_block->slab_class = static_cast<uint32_t>(class_index);
+    p_block->slab_slot = slot_id;
+    p_block->vk_parent_address = slab_class.get_vk_chunk_address(slot_id);
+
+    register_bindless(p_block);
+
+    return handle;
+}
+
+Graphics::MemoryBlockHandle Graphics::MemoryPool::alloc(size_t size) {
+    if (size <= SLAB_MAX_SLOT) {
+        MemoryBlockHandle handle = alloc_slot(size);
+
+        if (!handle.is_null()) {
+            return handle;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t chunk_index;
+    VmaVirtualAllocation vma_valloc;
+    VkDeviceSize offset;
+
+    alloc_range(size, block_alignment, chunk_index, vma_valloc, offset);
+
+    MemoryPoolChunk& chunk = chunks[chunk_index];
+    ResourceTable<MemoryBlock> *p_table = p_provider->get_memory_block_table();
+
+    MemoryBlockHandle handle = p_table->create(this, chunk_index, chunk.vk_buffer, vma_valloc, offset, size);
+
+    MemoryBlock *p_block = p_table->get(handle);
+    p_block->handle = handle;
+    p_block->vk_parent_address = chunk.vk_address;
+
+    chunk.blocks.insert(p_block);
+
+    register_bindless(p_block);
+
+    return handle;
+}
+
+void Graphics::MemoryPool::register_bindless(MemoryBlock *p_block) {
+    BindlessTable *p_bindless = p_provider->get_bindless_table();
+
+    if (p_bindless == nullptr || !(usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+        return;
+    }
+
+    p_block->bindless_index = p_bindless->register_buffer(p_block->vk_parent_buffer, p_block->vk_offset, p_block->size);
+}
+
+bool Graphics::MemoryPool::write(MemoryBlock *, const void *, size_t) {
+    return false;
+}
+
+void Graphics::MemoryPool::release_block(MemoryBlock *p_block) {
+    // Slots go straight back to their free list once the GPU is done with them, the slab itself stays
+    if (p_block->slab_slot != MemorySlabClass::NO_SLOT) {
+        MemorySlabClass *p_class = slab_classes[p_block->slab_class].get();
+        uint32_t slot_id = p_block->slab_slot;
+
+        p_provider->enqueue_release([p_class, slot_id](VulkanProvider*) {
+            p_class->push(slot_id);
+        });
+    } else {
+        chunks[p_block->chunk_index].blocks.erase(p_block);
+        release(p_block->chunk_index, p_block->vma_valloc);
+    }
+
+    // The index is only handed out again once the frames that may be reading it have finished
+    if (p_block->bindless_index != BindlessTable::INVALID_INDEX) {
+        p_provider->get_bindless_table()->release_buffer(p_block->bindless_index);
+    }
+
+    // Everything needed has been copied out, the handle goes stale from here on
+    p_provider->get_memory_block_table()->destroy(p_block->handle);
+}
+
+void Graphics::MemoryPool::destroy(MemoryBlock *p_block) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (p_block->destroy_pending) {
+        return;
+    }
+
+    // The staging pool still points at the block, complete_upload / complete_move finish the job
+    if (p_block->moving || !p_block->upload_complete) {
+        p_block->destroy_pending = true;
+        return;
+    }
+
+    release_block(p_block);
+}
+
+void Graphics::MemoryPool::complete_upload(MemoryBlock *p_block) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    p_block->upload_complete = true;
+
+    if (p_block->destroy_pending) {
+        release_block(p_block);
+    }
+}
+
+void Graphics::MemoryPool::release(size_t chunk_index, VmaVirtualAllocation vma_valloc) {
+    // Draws recorded in frames that are still in flight may be reading this range
+    p_provider->enqueue_release([this, chunk_index, vma_valloc](VulkanProvider*) {
+        free(chunk_index, vma_valloc);
+    });
+}
+
+void Graphics::MemoryPool::free(size_t chunk_index, VmaVirtualAllocation vma_valloc) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (chunk_index >= chunks.size() || chunks[chunk_index].vma_vblock == nullptr) {
+        throw std::runtime_error("chunk_index was out of range!");
+    }
 
-    push_chunk(p_provider);
+    MemoryPoolChunk& chunk = chunks[chunk_index];
+
+    VmaVirtualAllocationInfo valloc_info {};
+    vmaGetVirtualAllocationInfo(chunk.vma_vblock, vma_valloc, &valloc_info);
+
+    vmaVirtualFree(chunk.vma_vblock, vma_valloc);
+
+    chunk.alloc_count--;
+    chunk.used_bytes -= valloc_info.size;
+
+    if (chunk.alloc_count == 0) {
+        chunk.empty_since_frame = p_provider->get_frame_number();
+    }
+}
+
+void Graphics::MemoryPool::collect(uint64_t frame_number, uint64_t idle_frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& chunk : chunks) {
+        if (chunk.vk_buffer == nullptr || chunk.alloc_count > 0) {
+            continue;
+        }
+
+        // Evacuated chunks were emptied on purpose, there's no point in keeping them around
+        if (chunk.evacuating || frame_number - chunk.empty_since_frame >= idle_frames) {
+            release_chunk(chunk.chunk_index);
+        }
+    }
 }
 
-std::shared_ptr<Graphics::MemoryBlock> Graphics::MemoryPool::alloc(size_t size) {
-    // TODO: Safety here!!!!
+size_t Graphics::MemoryPool::find_defrag_chunk() {
+    size_t best_chunk = NO_CHUNK;
+    VkDeviceSize total_free = 0;
+
+    for (auto& chunk : chunks) {
+        if (chunk.vk_buffer != nullptr) {
+            total_free += chunk.size - chunk.used_bytes;
+        }
+    }
 
     for (auto& chunk : chunks) {
-        std::shared_ptr<MemoryBlock> block = chunk.try_alloc(size);
+        // Empty chunks are handled by collect(), and a mostly full chunk isn't worth moving
+        if (chunk.vk_buffer == nullptr || chunk.blocks.empty() || chunk.slab_count > 0 || chunk.used_bytes * 2 > chunk.size) {
+            continue;
+        }
+
+        // Everything in the chunk has to fit in the free space of the other chunks
+        // This doesn't account for fragmentation in the destinations, defragment() gives up if a move doesn't fit
+        VkDeviceSize free_elsewhere = total_free - (chunk.size - chunk.used_bytes);
+
+        if (chunk.used_bytes > free_elsewhere) {
+            continue;
+        }
 
-        if (block != nullptr) {
-            return block;
+        if (best_chunk == NO_CHUNK || chunk.used_bytes < chunks[best_chunk].used_bytes) {
+            best_chunk = chunk.chunk_index;
         }
     }
 
-    // TODO: Expand the pool
-    throw std::runtime_error("Unable to allocate memory!!!");
+    return best_chunk;
 }
 
-void Graphics::MemoryPool::push_chunk(Graphics::VulkanProvider *p_provider) {
-    if (p_provider == nullptr) {
-        throw std::runtime_error("p_provider was nullptr!");
+VkDeviceSize Graphics::MemoryPool::defragment(StagingMemoryPool *p_staging, VkDeviceSize budget) {
+    if (budget == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (defrag_chunk == NO_CHUNK) {
+        defrag_chunk = find_defrag_chunk();
+
+        if (defrag_chunk == NO_CHUNK) {
+            return 0;
+        }
+
+        chunks[defrag_chunk].evacuating = true;
+    }
+
+    MemoryPoolChunk& src_chunk = chunks[defrag_chunk];
+    VkDeviceSize moved = 0;
+
+    // Blocks are only ever released under our lock, so everything in the set stays alive while we look
+    size_t remaining = 0;
+
+    for (MemoryBlock* p_block : src_chunk.blocks) {
+        // Blocks still uploading or already moving are picked up on a later frame
+        if (p_block->moving || !p_block->upload_complete) {
+            remaining++;
+            continue;
+        }
+
+        // A block bigger than the whole budget still moves on its own, otherwise it would pin the chunk forever
+        if (moved > 0 && moved + p_block->size > budget) {
+            remaining++;
+            continue;
+        }
+
+        // Never grow the pool to make room, that would defeat the point
+        size_t dst_chunk_index = NO_CHUNK;
+        VmaVirtualAllocation vma_dst_valloc = nullptr;
+        VkDeviceSize dst_offset = 0;
+
+        for (auto& chunk : chunks) {
+            if (chunk.try_alloc_range(p_block->size, vma_dst_valloc, dst_offset, block_alignment)) {
+                dst_chunk_index = chunk.chunk_index;
+                break;
+            }
+        }
+
+        if (dst_chunk_index == NO_CHUNK) {
+            // The other chunks are too fragmented, stop evacuating and let allocations use this chunk again
+            src_chunk.evacuating = false;
+            defrag_chunk = NO_CHUNK;
+
+            return moved;
+        }
+
+        p_block->moving = true;
+        moved += p_block->size;
+
+        p_staging->enqueue_move(this, p_block, dst_chunk_index, vma_dst_valloc, chunks[dst_chunk_index].vk_buffer, dst_offset);
+    }
+
+    // Every block has been moved (or is in the middle of it), collect() frees the chunk once the old ranges are released
+    if (remaining == 0) {
+        defrag_chunk = NO_CHUNK;
+    }
+
+    return moved;
+}
+
+void Graphics::MemoryPool::complete_move(MemoryBlock *p_block, size_t dst_chunk_index, VmaVirtualAllocation vma_dst_valloc, VkDeviceSize dst_offset) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Frames that are still in flight may be reading from the old range
+    release(p_block->chunk_index, p_block->vma_valloc);
+    chunks[p_block->chunk_index].blocks.erase(p_block);
+
+    MemoryPoolChunk& dst_chunk = chunks[dst_chunk_index];
+
+    p_block->chunk_index = dst_chunk_index;
+    p_block->vk_parent_buffer = dst_chunk.vk_buffer;
+    p_block->vk_parent_address = dst_chunk.vk_address;
+    p_block->vma_valloc = vma_dst_valloc;
+    p_block->vk_offset = dst_offset;
+    p_block->moving = false;
+
+    dst_chunk.blocks.insert(p_block);
+
+    // Same index, new range, shaders never notice the move
+    if (p_block->bindless_index != BindlessTable::INVALID_INDEX) {
+        p_provider->get_bindless_table()->update_buffer(p_block->bindless_index, p_block->vk_parent_buffer, p_block->vk_offset, p_block->size);
+    }
+
+    if (p_block->destroy_pending) {
+        release_block(p_block);
     }
+}
 
+size_t Graphics::MemoryPool::push_chunk(size_t chunk_size) {
     VmaAllocator allocator = p_provider->get_vma_allocator();
     MemoryPoolChunk chunk {};
 
     // First create the vblock
     // This is used by VMA to help us break a bigger VkBuffer into smaller chunks
     VmaVirtualBlockCreateInfo block_create_info{};
-    block_create_info.size = size;
+    block_create_info.size = chunk_size;
 
     VkResult result = vmaCreateVirtualBlock(&block_create_info, &chunk.vma_vblock);
     if (result != VK_SUCCESS) {
@@ -118,89 +628,934 @@ void Graphics::MemoryPool::push_chunk(Graphics::VulkanProvider *p_provider) {
     // Then allocate the actual buffer
     VkBufferCreateInfo buffer_info = {};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.size = size;
+    buffer_info.size = chunk_size;
     buffer_info.usage = usage;
 
     VmaAllocationCreateInfo alloc_info = {};
     alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
     alloc_info.flags = flags;
+    alloc_info.requiredFlags = required_properties;
 
     result = vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &chunk.vk_buffer, &chunk.vma_alloc, &chunk.vma_alloc_info);
     if (result != VK_SUCCESS) {
+        vmaDestroyVirtualBlock(chunk.vma_vblock);
+
         LOG_GRAPHICS("vmaCreateBuffer failed with error code (" << result << ")");
         throw std::runtime_error("vmaCreateBuffer failed! Please check the log above for more info!");
     }
 
+    chunk.size = chunk_size;
+    chunk.empty_since_frame = p_provider->get_frame_number();
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR) {
+        chunk.vk_address = p_provider->get_vk_buffer_address(chunk.vk_buffer);
+    }
+
+    // Reuse a released slot if there is one
+    for (auto& slot : chunks) {
+        if (slot.vk_buffer == nullptr) {
+            chunk.chunk_index = slot.chunk_index;
+            slot = chunk;
+
+            return chunk.chunk_index;
+        }
+    }
+
     chunk.chunk_index = chunks.size();
     chunks.push_back(chunk);
-}
 
-//
-// StagingMemoryPool
-//
-Graphics::StagingMemoryPool::StagingMemoryPool(VulkanProvider *p_provider, size_t size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags)
-    : MemoryPool(p_provider, size, usage, flags)
-{
-    validate_handles(p_provider);
+    return chunk.chunk_index;
 }
 
-void Graphics::StagingMemoryPool::push_chunk(VulkanProvider *p_provider) {
-    MemoryPool::push_chunk(p_provider);
-    validate_handles(p_provider);
+void Graphics::MemoryPool::release_chunk(size_t chunk_index) {
+    MemoryPoolChunk& chunk = chunks[chunk_index];
+
+    // Cached descriptor sets may still point into the buffer
+    p_provider->get_descriptor_set_cache()->evict_buffer(chunk.vk_buffer);
+
+    vmaDestroyVirtualBlock(chunk.vma_vblock);
+    vmaDestroyBuffer(p_provider->get_vma_allocator(), chunk.vk_buffer, chunk.vma_alloc);
+
+    chunk = MemoryPoolChunk {};
+    chunk.chunk_index = chunk_index;
 }
 
-void Graphics::StagingMemoryPool::validate_handles(Sapphire::Graphics::VulkanProvider *p_provider) {
-    // TODO: Not be as naive and unsafe?
+Graphics::MemoryPoolStats Graphics::MemoryPool::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
 
-    VmaAllocator allocator = p_provider->get_vma_allocator();
+    MemoryPoolStats stats {};
 
-    for (auto chunk = chunks.begin() + handles.size(); chunk != chunks.end(); chunk++) {
-        void *handle = nullptr;
-        vmaMapMemory(allocator, chunk->vma_alloc, &handle);
+    // VMA only sees whole slabs, so their slots are accounted for by hand, indexed by chunk
+    std::vector<VkDeviceSize> slot_bytes(chunks.size(), 0);
+    std::vector<uint32_t> slot_count(chunks.size(), 0);
+    std::vector<VkDeviceSize> largest_free_slot(chunks.size(), 0);
+
+    for (auto& slab_class : slab_classes) {
+        for (uint32_t s = 0; s < slab_class->get_slab_count(); s++) {
+            const MemorySlabClass::Slab *p_slab = slab_class->get_slab_at(s);
+            uint32_t used_slots = p_slab->used_slots.load(std::memory_order_relaxed);
 
-        handles.push_back((char *) handle);
+            slot_bytes[p_slab->chunk_index] += used_slots * slab_class->get_slot_size();
+            slot_count[p_slab->chunk_index] += used_slots;
+
+            if (used_slots < slab_class->get_slots_per_slab()) {
+                largest_free_slot[p_slab->chunk_index] = std::max(largest_free_slot[p_slab->chunk_index], slab_class->get_slot_size());
+            }
+        }
     }
-}
 
-void Graphics::StagingMemoryPool::flush(VulkanProvider *p_provider) {
-    // TODO: Not make begin_upload as sloppy?
-    VkCommandBuffer vk_command_buffer = p_provider->begin_upload(VulkanProvider::QueueType::Transfer);
+    for (auto& chunk : chunks) {
+        if (chunk.vma_vblock == nullptr) {
+            continue;
+        }
 
-    for (auto& upload : upload_queue) {
-        VkBufferCopy copy_region{};
-        copy_region.srcOffset = upload.src_block->get_vk_offset();
-        copy_region.dstOffset = upload.dst_block->get_vk_offset();
-        copy_region.size = upload.size;
+        VmaDetailedStatistics vma_stats {};
+        vmaCalculateVirtualBlockStatistics(chunk.vma_vblock, &vma_stats);
 
-        vkCmdCopyBuffer(vk_command_buffer, upload.src_block->get_vk_buffer(), upload.dst_block->get_vk_buffer(), 1, &copy_region);
-    }
+        size_t c = chunk.chunk_index;
 
-    p_provider->end_upload(VulkanProvider::QueueType::Transfer, vk_command_buffer);
+        // Each slab is a single SLAB_SIZE allocation to VMA, swap it for the slots that are actually taken
+        MemoryChunkStats chunk_stats {};
+        chunk_stats.chunk_index = c;
+        chunk_stats.size = chunk.size;
+        chunk_stats.used_bytes = vma_stats.statistics.allocationBytes - chunk.slab_count * SLAB_SIZE + slot_bytes[c];
+        chunk_stats.alloc_count = static_cast<uint32_t>(vma_stats.statistics.allocationCount - chunk.slab_count + slot_count[c]);
+        chunk_stats.largest_free_range = std::max(vma_stats.unusedRangeCount > 0 ? vma_stats.unusedRangeSizeMax : 0, largest_free_slot[c]);
+        chunk_stats.fragmentation = fragmentation_ratio(chunk.size - chunk_stats.used_bytes, chunk_stats.largest_free_range);
+        chunk_stats.slab_count = chunk.slab_count;
 
-    // TODO: If async do this better
-    // Notify all our queued upload destinations that they're now ready
-    for (auto& upload : upload_queue) {
-        upload.dst_block->upload_complete = true;
+        stats.size += chunk_stats.size;
+        stats.used_bytes += chunk_stats.used_bytes;
+        stats.alloc_count += chunk_stats.alloc_count;
+        stats.largest_free_range = std::max(stats.largest_free_range, chunk_stats.largest_free_range);
+
+        stats.chunks.push_back(chunk_stats);
     }
 
-    upload_queue.clear();
+    stats.fragmentation = fragmentation_ratio(stats.size - stats.used_bytes, stats.largest_free_range);
+    return stats;
 }
 
-// TODO: Async uploading?
-void Graphics::StagingMemoryPool::enqueue_upload(size_t size, void *src, std::shared_ptr<Graphics::MemoryBlock> dst) {
-    // TODO: Safety
-    dst->upload_complete = false;
+std::string Graphics::MemoryPool::get_detailed_map(size_t chunk_index) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (chunk_index >= chunks.size() || chunks[chunk_index].vma_vblock == nullptr) {
+        return "null";
+    }
+
+    VmaVirtualBlock vma_vblock = chunks[chunk_index].vma_vblock;
+
+    char *vma_string = nullptr;
+    vmaBuildVirtualBlockStatsString(vma_vblock, &vma_string, VK_TRUE);
+
+    std::string map = "{\"ranges\": ";
+    map += vma_string;
+    vmaFreeVirtualBlockStatsString(vma_vblock, vma_string);
 
-    // Our temp block has no other purpose than to signal where our memory is going
-    auto temp_block = alloc(size);
+    // VMA lists each slab as one range, so their slots are listed separately
+    map += ", \"slabs\": [";
+    bool first = true;
 
-    char* staging = handles[temp_block->get_chunk_index()] + temp_block->get_vk_offset();
-    memcpy(staging, src, size);
+    for (auto& slab_class : slab_classes) {
+        for (uint32_t s = 0; s < slab_class->get_slab_count(); s++) {
+            const MemorySlabClass::Slab *p_slab = slab_class->get_slab_at(s);
+
+            if (p_slab->chunk_index != chunk_index) {
+                continue;
+            }
+
+            map += first ? "" : ", ";
+            map += "{\"offset\": " + std::to_string(p_slab->offset);
+            map += ", \"slot_size\": " + std::to_string(slab_class->get_slot_size());
+            map += ", \"slots\": " + std::to_string(slab_class->get_slots_per_slab());
+            map += ", \"used_slots\": " + std::to_string(p_slab->used_slots.load(std::memory_order_relaxed)) + "}";
+
+            first = false;
+        }
+    }
+
+    map += "]}";
+
+    return map;
+}
+
+//
+// MappedMemoryPool
+//
+Graphics::MappedMemoryPool::MappedMemoryPool(VulkanProvider *p_provider, size_t min_chunk_size, size_t max_chunk_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkMemoryPropertyFlags required_properties)
+    : MemoryPool(p_provider, min_chunk_size, max_chunk_size, usage, flags, required_properties)
+{
+
+}
+
+size_t Graphics::MappedMemoryPool::push_chunk(size_t chunk_size) {
+    size_t chunk_index;
+
+    // Only device local pools have somewhere to fall back to, the staging ring itself has to be mappable
+    // Falling back clears the required properties, so every chunk after that is device local only
+    if (required_properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+        try {
+            chunk_index = MemoryPool::push_chunk(chunk_size);
+            validate_handles();
+
+            return chunk_index;
+        } catch (const std::runtime_error &) {
+            // The mappable heap is small (usually 256 MiB without ReBAR), so running out of it isn't fatal
+            LOG_GRAPHICS("Warning: Out of host visible device memory, falling back to staged uploads");
+
+            flags = 0;
+            required_properties = 0;
+        }
+    }
+
+    chunk_index = MemoryPool::push_chunk(chunk_size);
+    validate_handles();
+
+    return chunk_index;
+}
+
+void Graphics::MappedMemoryPool::release_chunk(size_t chunk_index) {
+    if (chunk_index < handles.size() && handles[chunk_index] != nullptr) {
+        vmaUnmapMemory(p_provider->get_vma_allocator(), chunks[chunk_index].vma_alloc);
+        handles[chunk_index] = nullptr;
+    }
+
+    MemoryPool::release_chunk(chunk_index);
+}
+
+void Graphics::MappedMemoryPool::validate_handles() {
+    // TODO: Not be as naive and unsafe?
+
+    VmaAllocator allocator = p_provider->get_vma_allocator();
+
+    handles.resize(chunks.size(), nullptr);
+
+    for (size_t c = 0; c < chunks.size(); c++) {
+        if (handles[c] != nullptr || chunks[c].vk_buffer == nullptr) {
+            continue;
+        }
+
+        // Chunks allocated after falling back can't be mapped
+        VkMemoryPropertyFlags vk_properties = 0;
+        vmaGetAllocationMemoryProperties(allocator, chunks[c].vma_alloc, &vk_properties);
+
+        if (!(vk_properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+            continue;
+        }
+
+        void *handle = nullptr;
+        vmaMapMemory(allocator, chunks[c].vma_alloc, &handle);
+
+        handles[c] = (char *) handle;
+    }
+}
+
+bool Graphics::MappedMemoryPool::write(MemoryBlock *p_block, const void *src, size_t size) {
+    // Other threads may be growing the handle list, so only look it up under the lock
+    char *handle;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = handles[p_block->get_chunk_index()];
+    }
+
+    if (handle == nullptr) {
+        return false;
+    }
+
+    // Fresh blocks are never in use by the GPU, and the memory is coherent
+    // So the next queue submission makes the write visible without any barriers
+    memcpy(handle + p_block->get_vk_offset(), src, size);
+    return true;
+}
+
+//
+// StagingMemoryPool
+//
+thread_local std::shared_ptr<Graphics::StagingMemoryPool::StagingArena> Graphics::StagingMemoryPool::tls_arena = nullptr;
+thread_local Graphics::StagingMemoryPool *Graphics::StagingMemoryPool::tls_arena_owner = nullptr;
+
+Graphics::StagingMemoryPool::StagingMemoryPool(VulkanProvider *p_provider, size_t ring_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags)
+    : MappedMemoryPool(p_provider, ring_size, ring_size, usage, flags)
+{
+    this->ring_size = ring_size - (ring_size % RING_ALIGNMENT);
+    this->flush_thread = std::this_thread::get_id();
+}
+
+void Graphics::StagingMemoryPool::collect(uint64_t, uint64_t) {
+    // Ring regions aren't tracked as blocks, the chunk would always look empty to MemoryPool::collect
+}
+
+Graphics::MemoryPoolStats Graphics::StagingMemoryPool::get_stats() {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+
+    MemoryPoolStats stats {};
+
+    if (chunks.empty()) {
+        return stats;
+    }
+
+    // Free space is the gap between the head and the tail, which may wrap around the end
+    VkDeviceSize largest_free_range = ring_size;
+
+    if (ring_used > 0) {
+        VkDeviceSize ring_tail = (ring_head + ring_size - ring_used) % ring_size;
+
+        if (ring_tail <= ring_head) {
+            largest_free_range = std::max(ring_size - ring_head, ring_tail);
+        } else {
+            largest_free_range = ring_tail - ring_head;
+        }
+    }
+
+    MemoryChunkStats chunk_stats {};
+    chunk_stats.chunk_index = 0;
+    chunk_stats.size = ring_size;
+    chunk_stats.used_bytes = ring_used;
+    chunk_stats.alloc_count = static_cast<uint32_t>(live_arenas.size() + inflight_batches.size());
+    chunk_stats.largest_free_range = largest_free_range;
+    chunk_stats.fragmentation = fragmentation_ratio(ring_size - ring_used, largest_free_range);
+
+    stats.size = chunk_stats.size;
+    stats.used_bytes = chunk_stats.used_bytes;
+    stats.alloc_count = chunk_stats.alloc_count;
+    stats.largest_free_range = chunk_stats.largest_free_range;
+    stats.fragmentation = chunk_stats.fragmentation;
+    stats.chunks.push_back(chunk_stats);
+
+    return stats;
+}
+
+std::string Graphics::StagingMemoryPool::get_detailed_map(size_t) {
+    // The ring has no ranges of its own to list
+    return "null";
+}
+
+// Every stage that might read uploaded memory
+const VkPipelineStageFlags UPLOAD_READ_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+const VkAccessFlags UPLOAD_READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+template<typename T>
+T pop_recycled(std::vector<T> &recycled) {
+    if (recycled.empty()) {
+        return nullptr;
+    }
+
+    T value = recycled.back();
+    recycled.pop_back();
+
+    return value;
+}
+
+FrameVector<Graphics::StagingMemoryPool::CopyGroup> Graphics::StagingMemoryPool::coalesce_copies(VulkanProvider *p_provider, const UploadBatch &batch, bool uploads, bool moves) {
+    FrameArena *p_arena = p_provider->get_frame_arena();
+
+    struct PairedCopy {
+        VkBuffer vk_src_buffer;
+        VkBuffer vk_dst_buffer;
+        VkBufferCopy region;
+    };
+
+    FrameVector<PairedCopy> copies(p_arena);
+    copies.reserve((uploads ? batch.uploads.size() : 0) + (moves ? batch.moves.size() : 0));
+
+    for (auto& upload : batch.uploads) {
+        if (!uploads) {
+            break;
+        }
+
+        VkBufferCopy copy_region{};
+        copy_region.srcOffset = upload.src_offset;
+        copy_region.dstOffset = upload.p_dst_block->get_vk_offset() + upload.dst_offset;
+        copy_region.size = upload.size;
+
+        copies.push_back({chunks[0].vk_buffer, upload.p_dst_block->get_vk_buffer(), copy_region});
+    }
+
+    for (auto& move : batch.moves) {
+        if (!moves) {
+            break;
+        }
+
+        VkBufferCopy copy_region{};
+        copy_region.srcOffset = move.p_block->get_vk_offset();
+        copy_region.dstOffset = move.dst_offset;
+        copy_region.size = move.p_block->get_size();
+
+        copies.push_back({move.p_block->get_vk_buffer(), move.vk_dst_buffer, copy_region});
+    }
+
+    // Sorting by (src, dst, dst offset) puts every buffer pair next to each other, in order
+    std::sort(copies.begin(), copies.end(), [](const PairedCopy &lhs, const PairedCopy &rhs) {
+        return std::tie(lhs.vk_src_buffer, lhs.vk_dst_buffer, lhs.region.dstOffset) < std::tie(rhs.vk_src_buffer, rhs.vk_dst_buffer, rhs.region.dstOffset);
+    });
+
+    FrameVector<CopyGroup> groups(p_arena);
+
+    for (auto& copy : copies) {
+        if (groups.empty() || groups.back().vk_src_buffer != copy.vk_src_buffer || groups.back().vk_dst_buffer != copy.vk_dst_buffer) {
+            groups.emplace_back(p_arena, copy.vk_src_buffer, copy.vk_dst_buffer);
+        }
+
+        CopyGroup& group = groups.back();
+
+        // Regions that are contiguous on both sides become a single region
+        if (!group.regions.empty()) {
+            VkBufferCopy& last = group.regions.back();
+
+            if (last.srcOffset + last.size == copy.region.srcOffset && last.dstOffset + last.size == copy.region.dstOffset) {
+                last.size += copy.region.size;
+                continue;
+            }
+        }
+
+        group.regions.push_back(copy.region);
+    }
+
+    return groups;
+}
+
+void Graphics::StagingMemoryPool::record_ownership_transfer(VulkanProvider *p_provider, const FrameVector<CopyGroup> &groups, VkCommandBuffer vk_release_buffer, VkCommandBuffer vk_acquire_buffer) {
+    uint32_t transfer_family = p_provider->get_queue(VulkanProvider::QueueType::Transfer).family;
+    uint32_t graphics_family = p_provider->get_queue(VulkanProvider::QueueType::Graphics).family;
+
+    FrameVector<VkBufferMemoryBarrier> release_barriers(p_provider->get_frame_arena());
+    FrameVector<VkBufferMemoryBarrier> acquire_barriers(p_provider->get_frame_arena());
+
+    // One barrier per merged region rather than per upload
+    for (auto& group : groups) {
+        for (auto& region : group.regions) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = transfer_family;
+            barrier.dstQueueFamilyIndex = graphics_family;
+            barrier.buffer = group.vk_dst_buffer;
+            barrier.offset = region.dstOffset;
+            barrier.size = region.size;
+
+            // The release half only makes the transfer writes available
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            release_barriers.push_back(barrier);
+
+            // The acquire half makes them visible to whatever reads them on the graphics queue
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+            acquire_barriers.push_back(barrier);
+        }
+    }
+
+    vkCmdPipelineBarrier(
+        vk_release_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(release_barriers.size()),
+        release_barriers.data(),
+        0,
+        nullptr
+    );
+
+    vkCmdPipelineBarrier(
+        vk_acquire_buffer,
+        UPLOAD_READ_STAGES,
+        UPLOAD_READ_STAGES,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(acquire_barriers.size()),
+        acquire_barriers.data(),
+        0,
+        nullptr
+    );
+}
+
+void Graphics::StagingMemoryPool::record_moves(VulkanProvider *p_provider, const UploadBatch &batch, VkCommandBuffer vk_cmd_buffer) {
+    // The sources were written by earlier uploads, which were acquired for UPLOAD_READ_STAGES, chain onto that and make them visible to our reads
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        vk_cmd_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | UPLOAD_READ_STAGES,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+
+    FrameVector<CopyGroup> groups = coalesce_copies(p_provider, batch, false, true);
+
+    for (auto& group : groups) {
+        vkCmdCopyBuffer(vk_cmd_buffer, group.vk_src_buffer, group.vk_dst_buffer, static_cast<uint32_t>(group.regions.size()), group.regions.data());
+    }
+
+    // The new ranges are read by frames recorded once the move retires
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+
+    vkCmdPipelineBarrier(
+        vk_cmd_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        UPLOAD_READ_STAGES,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+}
+
+void Graphics::StagingMemoryPool::flush(VulkanProvider *p_provider, bool ignore_budget) {
+    // Pick up anything that landed since the last flush, this never blocks
+    retire(p_provider, false);
+
+    // Take every arena handed out so far, along with the ring bytes they reserved
+    VkDeviceSize charged;
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        sealed_arenas.swap(live_arenas);
+        charged = ring_pending;
+        ring_pending = 0;
+    }
+
+    // Once an arena is sealed and has no writers left, all of its uploads are in the queue
+    for (auto& arena : sealed_arenas) {
+        arena->sealed = true;
+
+        while (arena->writers != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    sealed_arenas.clear();
+
+    upload_queue.drain(drained_uploads);
+
+    // Uploads are always drained no later than the flush that charges their arena
+    // So their bytes can't be given back before they land, even if they sit in the pending queue for a while
+    if (charged > 0 || !drained_uploads.empty()) {
+        uint64_t generation = first_generation + ring_generations.size();
+        ring_generations.push_back({charged, drained_uploads.size()});
+
+        for (auto& upload : drained_uploads) {
+            upload.sequence = next_sequence++;
+            upload.generation = generation;
+
+            pending_uploads.push(std::move(upload));
+        }
+
+        // An empty generation can be released right away if nothing older is waiting
+        release_generations();
+    }
+
+    drained_uploads.clear();
+
+    // Reuse the lists of a retired batch, they're already large enough
+    UploadBatch batch {};
+
+    if (!free_batches.empty()) {
+        batch.uploads = std::move(free_batches.back().uploads);
+        batch.moves = std::move(free_batches.back().moves);
+
+        free_batches.pop_back();
+    }
+
+    // Spend the budget highest priority first, the first upload always goes out so oversized pieces can't stall
+    VkDeviceSize spent = 0;
+
+    while (!pending_uploads.empty()) {
+        const StagedUpload& upload = pending_uploads.top();
+
+        if (!ignore_budget && upload_budget != 0 && spent > 0 && spent + upload.size > upload_budget) {
+            break;
+        }
+
+        spent += upload.size;
+        batch.uploads.push_back(upload);
+
+        pending_uploads.pop();
+    }
+
+    batch.moves.swap(move_queue);
+
+    if (batch.uploads.empty() && batch.moves.empty()) {
+        free_batches.push_back(std::move(batch));
+        return;
+    }
+
+    bool dedicated_transfer = p_provider->has_dedicated_transfer_queue();
+
+    batch.vk_fence = pop_recycled(free_fences);
+
+    if (batch.vk_fence == nullptr) {
+        batch.vk_fence = p_provider->create_vk_fence(false);
+    }
+
+    if (!dedicated_transfer) {
+        batch.vk_transfer_buffer = p_provider->begin_upload(VulkanProvider::QueueType::Transfer, pop_recycled(free_transfer_buffers));
+
+        // Move sources were written by earlier transfers, make sure those writes are visible to our reads
+        if (!batch.moves.empty()) {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(
+                batch.vk_transfer_buffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1,
+                &barrier,
+                0,
+                nullptr,
+                0,
+                nullptr
+            );
+        }
+
+        // One multi-region copy per buffer pair
+        FrameVector<CopyGroup> groups = coalesce_copies(p_provider, batch, true, true);
+
+        for (auto& group : groups) {
+            vkCmdCopyBuffer(batch.vk_transfer_buffer, group.vk_src_buffer, group.vk_dst_buffer, static_cast<uint32_t>(group.regions.size()), group.regions.data());
+        }
+
+        // Same family, so no ownership transfer is needed, just make the writes visible to later submissions
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+
+        vkCmdPipelineBarrier(
+            batch.vk_transfer_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            UPLOAD_READ_STAGES,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+
+        VulkanProvider::UploadSync sync {};
+        sync.vk_fence = batch.vk_fence;
+
+        p_provider->end_upload(VulkanProvider::QueueType::Transfer, batch.vk_transfer_buffer, sync);
+
+        inflight_batches.push_back(std::move(batch));
+        return;
+    }
+
+    // With a dedicated transfer queue, everything after the uploads' acquire runs on the graphics queue
+    batch.vk_acquire_buffer = p_provider->begin_upload(VulkanProvider::QueueType::Graphics, pop_recycled(free_graphics_buffers));
+
+    VulkanProvider::UploadSync acquire_sync {};
+    acquire_sync.vk_fence = batch.vk_fence;
+
+    if (!batch.uploads.empty()) {
+        batch.vk_transfer_buffer = p_provider->begin_upload(VulkanProvider::QueueType::Transfer, pop_recycled(free_transfer_buffers));
+
+        FrameVector<CopyGroup> groups = coalesce_copies(p_provider, batch, true, false);
+
+        for (auto& group : groups) {
+            vkCmdCopyBuffer(batch.vk_transfer_buffer, group.vk_src_buffer, group.vk_dst_buffer, static_cast<uint32_t>(group.regions.size()), group.regions.data());
+        }
+
+        // The destination ranges are released by the transfer queue and acquired by the graphics queue
+        // The graphics side waits on the transfer side through a semaphore and signals the fence
+        batch.vk_semaphore = pop_recycled(free_semaphores);
+
+        if (batch.vk_semaphore == nullptr) {
+            batch.vk_semaphore = p_provider->create_vk_semaphore();
+        }
+
+        record_ownership_transfer(p_provider, groups, batch.vk_transfer_buffer, batch.vk_acquire_buffer);
+
+        VulkanProvider::UploadSync release_sync {};
+        release_sync.vk_signal_semaphore = batch.vk_semaphore;
+
+        p_provider->end_upload(VulkanProvider::QueueType::Transfer, batch.vk_transfer_buffer, release_sync);
+
+        acquire_sync.vk_wait_semaphore = batch.vk_semaphore;
+        acquire_sync.vk_wait_stages = UPLOAD_READ_STAGES;
+    }
+
+    // Moves are copied on the graphics queue, so their source ranges never leave it
+    // Frames recorded before the move retires keep reading the old range, which stays graphics owned the whole time
+    if (!batch.moves.empty()) {
+        record_moves(p_provider, batch, batch.vk_acquire_buffer);
+    }
+
+    p_provider->end_upload(VulkanProvider::QueueType::Graphics, batch.vk_acquire_buffer, acquire_sync);
+
+    inflight_batches.push_back(std::move(batch));
+}
+
+bool Graphics::StagingMemoryPool::retire_front(VulkanProvider *p_provider, bool wait) {
+    if (inflight_batches.empty()) {
+        return false;
+    }
+
+    VkDevice vk_device = p_provider->get_vk_device();
+    UploadBatch& batch = inflight_batches.front();
+
+    VkResult result;
+    if (wait) {
+        result = vkWaitForFences(vk_device, 1, &batch.vk_fence, VK_TRUE, UINT64_MAX);
+    } else {
+        result = vkGetFenceStatus(vk_device, batch.vk_fence);
+
+        if (result == VK_NOT_READY) {
+            return false;
+        }
+    }
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: Upload fence failed with error code (" << result << ")");
+        throw std::runtime_error("Upload fence failed! Please check the log above for more info!");
+    }
+
+    // Notify all our uploaded destinations that they're now ready
+    for (auto& upload : batch.uploads) {
+        if (upload.final_piece) {
+            upload.p_dst_block->p_pool->complete_upload(upload.p_dst_block);
+        }
+
+        ring_generations[upload.generation - first_generation].remaining--;
+    }
+
+    // Moved blocks switch over to their new range
+    // This may run in the middle of recording a frame (enqueue_upload / acquire_arena retire too), so earlier draws may still point at the old range
+    // That's fine, the old range stays valid and graphics owned until complete_move's release has waited out the frames in flight
+    for (auto& move : batch.moves) {
+        move.p_pool->complete_move(move.p_block, move.dst_chunk_index, move.vma_dst_valloc, move.dst_offset);
+    }
+
+    // The GPU is done reading this batch's part of the ring
+    release_generations();
+
+    vkResetFences(vk_device, 1, &batch.vk_fence);
+
+    free_fences.push_back(batch.vk_fence);
+
+    if (batch.vk_transfer_buffer != nullptr) {
+        free_transfer_buffers.push_back(batch.vk_transfer_buffer);
+    }
+
+    if (batch.vk_semaphore != nullptr) {
+        free_semaphores.push_back(batch.vk_semaphore);
+    }
+
+    if (batch.vk_acquire_buffer != nullptr) {
+        free_graphics_buffers.push_back(batch.vk_acquire_buffer);
+    }
+
+    // Only the lists are kept, a recycled batch starts with fresh sync objects
+    batch.uploads.clear();
+    batch.moves.clear();
+
+    free_batches.push_back(std::move(batch));
+    inflight_batches.pop_front();
+    return true;
+}
+
+void Graphics::StagingMemoryPool::retire(VulkanProvider *p_provider, bool wait) {
+    while (retire_front(p_provider, wait)) {
+        // Keep going until we hit a batch that hasn't finished yet
+    }
+}
+
+void Graphics::StagingMemoryPool::await(VulkanProvider *p_provider) {
+    flush(p_provider, true);
+    retire(p_provider, true);
+}
+
+void Graphics::StagingMemoryPool::release_generations() {
+    VkDeviceSize released = 0;
+
+    while (!ring_generations.empty() && ring_generations.front().remaining == 0) {
+        released += ring_generations.front().bytes;
+
+        ring_generations.pop_front();
+        first_generation++;
+    }
+
+    if (released == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        ring_used -= released;
+    }
+
+    ring_space.notify_all();
+}
+
+void Graphics::StagingMemoryPool::set_upload_budget(VkDeviceSize bytes) {
+    upload_budget = bytes;
+}
+
+bool Graphics::StagingMemoryPool::try_reserve(VkDeviceSize size, VkDeviceSize &offset) {
+    if (ring_used == 0) {
+        ring_head = 0;
+    }
+
+    if (ring_used + size > ring_size) {
+        return false;
+    }
+
+    // The oldest live byte, everything between the head and the tail is free
+    VkDeviceSize ring_tail = (ring_head + ring_size - ring_used) % ring_size;
+    VkDeviceSize reserved = size;
+
+    if (ring_tail <= ring_head) {
+        if (ring_head + size <= ring_size) {
+            offset = ring_head;
+        } else if (size <= ring_tail) {
+            // Not enough room before the end, skip the remainder and wrap around
+            reserved += ring_size - ring_head;
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        if (ring_head + size <= ring_tail) {
+            offset = ring_head;
+        } else {
+            return false;
+        }
+    }
+
+    if (ring_used + reserved > ring_size) {
+        return false;
+    }
+
+    ring_head = (offset + size) % ring_size;
+    ring_used += reserved;
+    ring_pending += reserved;
+
+    return true;
+}
+
+std::shared_ptr<Graphics::StagingMemoryPool::StagingArena> Graphics::StagingMemoryPool::acquire_arena(VulkanProvider *p_provider, VkDeviceSize size) {
+    VkDeviceSize arena_size = std::min(std::max(size, ARENA_SIZE), ring_size);
+
+    std::unique_lock<std::mutex> lock(ring_mutex);
+
+    // The ring is only created once something is actually uploaded
+    if (chunks.empty()) {
+        push_chunk(ring_size);
+    }
+
+    VkDeviceSize offset = 0;
+    while (!try_reserve(arena_size, offset)) {
+        // Settle for a smaller arena before waiting on the GPU
+        if (arena_size > size && try_reserve(size, offset)) {
+            arena_size = size;
+            break;
+        }
+
+        if (std::this_thread::get_id() != flush_thread) {
+            ring_space.wait(lock);
+            continue;
+        }
+
+        // Out of room, submit what we have so far and wait for the oldest batch to give its bytes back
+        bool pending = ring_pending != 0;
+        lock.unlock();
+
+        // The ring is full, so whatever is queued goes out regardless of the budget
+        if (pending || !upload_queue.empty() || !pending_uploads.empty()) {
+            flush(p_provider, true);
+        } else if (!retire_front(p_provider, true)) {
+            throw std::runtime_error("Staging ring is out of space with nothing in flight!");
+        }
+
+        lock.lock();
+    }
+
+    auto arena = std::make_shared<StagingArena>();
+    arena->offset = offset;
+    arena->size = arena_size;
+
+    live_arenas.push_back(arena);
+    return arena;
+}
+
+void Graphics::StagingMemoryPool::enqueue_upload(VulkanProvider *p_provider, size_t size, void *src, MemoryBlock *p_dst, VulkanProvider::UploadPriority priority) {
+    // Pieces never exceed the ring, so an empty ring can always fit one
+    const VkDeviceSize max_piece = ring_size;
+
+    std::shared_ptr<StagingArena> arena = tls_arena_owner == this ? tls_arena : nullptr;
+
+    VkDeviceSize uploaded = 0;
+    while (uploaded < size) {
+        VkDeviceSize piece = std::min<VkDeviceSize>(size - uploaded, max_piece);
+        VkDeviceSize reserve_size = (piece + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+        reserve_size = std::min(reserve_size, max_piece);
+
+        // Announce ourselves before checking the seal, so a flush either sees us writing or we see the seal
+        while (true) {
+            if (arena != nullptr) {
+                arena->writers++;
+
+                if (!arena->sealed && arena->size - arena->used >= reserve_size) {
+                    break;
+                }
+
+                arena->writers--;
+            }
+
+            arena = acquire_arena(p_provider, reserve_size);
+
+            tls_arena = arena;
+            tls_arena_owner = this;
+        }
+
+        VkDeviceSize offset = arena->offset + arena->used;
+        arena->used += reserve_size;
+
+        memcpy(handles[0] + offset, (char*)src + uploaded, piece);
+
+        StagedUpload upload {};
+        upload.p_dst_block = p_dst;
+        upload.src_offset = offset;
+        upload.dst_offset = uploaded;
+        upload.size = piece;
+        upload.final_piece = uploaded + piece == size;
+        upload.priority = priority;
+
+        upload_queue.push(std::move(upload));
+
+        arena->writers--;
+
+        uploaded += piece;
+    }
+}
 
-    StagedUpload upload {};
-    upload.src_block = temp_block;
-    upload.dst_block = dst;
-    upload.size = size;
+void Graphics::StagingMemoryPool::enqueue_move(MemoryPool *p_pool, MemoryBlock *p_block, size_t dst_chunk_index, VmaVirtualAllocation vma_dst_valloc, VkBuffer vk_dst_buffer, VkDeviceSize dst_offset) {
+    StagedMove move {};
+    move.p_block = p_block;
+    move.p_pool = p_pool;
+    move.dst_chunk_index = dst_chunk_index;
+    move.vma_dst_valloc = vma_dst_valloc;
+    move.vk_dst_buffer = vk_dst_buffer;
+    move.dst_offset = dst_offset;
 
-    upload_queue.push_back(upload);
+    move_queue.push_back(move);
 }
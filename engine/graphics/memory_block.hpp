@@ -28,32 +28,83 @@ SOFTWARE.
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include <data/mpsc_queue.hpp>
+#include <graphics/bindless_table.hpp>
+#include <graphics/vulkan_provider.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 namespace Sapphire::Graphics {
     class VulkanProvider;
+    class MemoryPool;
+    class StagingMemoryPool;
 
-    // A block of memory allocated by the provider
+    // A block of memory allocated by the provider, referenced through a MemoryBlockHandle
+    // The range is returned to its pool once the block is destroyed and the GPU is done with it
+    // Blocks may be moved by defragmentation between frames, so don't cache the buffer or offset across frames!
     class MemoryBlock {
+        friend class MemoryPool;
         friend class StagingMemoryPool;
 
     protected:
+        MemoryPool *p_pool = nullptr;
+
         // TODO: Rather than storing the buffer, instead require the user pass it back into the provider?
         VkBuffer vk_parent_buffer = nullptr;
+        VkDeviceAddress vk_parent_address = 0;
         VmaVirtualAllocation vma_valloc;
         VkDeviceSize vk_offset;
+        VkDeviceSize size;
         size_t chunk_index = -1;
-        bool upload_complete = true;
+        MemoryBlockHandle handle {};
+
+        // Stays the same for the block's whole life, even if defragmentation moves it
+        uint32_t bindless_index = BindlessTable::INVALID_INDEX;
+
+        // Blocks start out empty, so defragmentation can't pick one up before its upload is queued
+        std::atomic<bool> upload_complete = false;
+        bool moving = false;
+
+        // Destroyed while an upload or move was still writing to it, the range is released once that lands
+        bool destroy_pending = false;
+
+        // Blocks carved out of a slab are returned to their size class instead of VMA, see MemorySlabClass
+        uint32_t slab_class = -1;
+        uint32_t slab_slot = 0;
 
     public:
         MemoryBlock() = delete;
-        MemoryBlock(size_t chunk_index, VkBuffer vk_parent_buffer, VmaVirtualAllocation vma_valloc, VkDeviceSize vk_offset);
+        MemoryBlock(MemoryPool *p_pool, size_t chunk_index, VkBuffer vk_parent_buffer, VmaVirtualAllocation vma_valloc, VkDeviceSize vk_offset, VkDeviceSize size);
 
+        // Blocks own their range, copying them would free it twice
+        MemoryBlock(const MemoryBlock&) = delete;
+        MemoryBlock& operator=(const MemoryBlock&) = delete;
+
+        MemoryPool *get_pool();
         VkBuffer get_vk_buffer();
         VkDeviceSize get_vk_offset();
+        VkDeviceSize get_size();
         size_t get_chunk_index();
 
+        // The GPU address of the block (the chunk's base address plus the offset), for reading it through a pointer in shaders
+        // 0 if VK_KHR_buffer_device_address isn't enabled, changes if defragmentation moves the block
+        [[nodiscard]]
+        VkDeviceAddress get_vk_address() const;
+
+        // The block's index into the storage buffer array of the bindless table
+        // INVALID_INDEX if there is no bindless table, or the table was full when the block was allocated
+        [[nodiscard]]
+        uint32_t get_bindless_index() const;
+
         [[nodiscard]]
         bool is_uploaded() const {
             return upload_complete;
@@ -62,59 +113,447 @@ namespace Sapphire::Graphics {
 
     class MemoryPoolChunk {
     public:
-        VmaVirtualBlock vma_vblock;
-        VkBuffer vk_buffer;
-        VmaAllocation vma_alloc;
-        VmaAllocationInfo vma_alloc_info;
+        VmaVirtualBlock vma_vblock = nullptr;
+        VkBuffer vk_buffer = nullptr;
+        VkDeviceAddress vk_address = 0;
+        VmaAllocation vma_alloc = nullptr;
+        VmaAllocationInfo vma_alloc_info {};
         size_t chunk_index = -1;
+        size_t size = 0;
+
+        // How many ranges are allocated in this chunk, and since which frame it has been empty
+        size_t alloc_count = 0;
+        VkDeviceSize used_bytes = 0;
+        uint64_t empty_since_frame = 0;
 
-        std::shared_ptr<MemoryBlock> try_alloc(size_t size);
+        // The live blocks inside this chunk, used to find what to move when defragmenting
+        std::unordered_set<MemoryBlock*> blocks;
+
+        // Set while defragmentation empties this chunk, nothing new is allocated from it
+        bool evacuating = false;
+
+        // Slabs are never moved, so chunks holding any are skipped by defragmentation
+        size_t slab_count = 0;
+
+        // Allocates a raw range, returns false if the chunk doesn't have a large enough free range
+        bool try_alloc_range(VkDeviceSize size, VmaVirtualAllocation &vma_valloc, VkDeviceSize &offset, VkDeviceSize alignment = 0);
     };
 
+    // Usage of a single pool chunk, in bytes
+    // Fragmentation is 1 - largest_free_range / free_bytes, 0 when all free space is one contiguous range
+    struct MemoryChunkStats {
+        size_t chunk_index = 0;
+        VkDeviceSize size = 0;
+        VkDeviceSize used_bytes = 0;
+        uint32_t alloc_count = 0;
+        VkDeviceSize largest_free_range = 0;
+        float fragmentation = 0.0f;
+        size_t slab_count = 0;
+    };
+
+    // Usage of a whole pool, the same as MemoryChunkStats but summed over every live chunk
+    // The largest free range is the largest of any single chunk
+    struct MemoryPoolStats {
+        std::string name;
+        VkDeviceSize size = 0;
+        VkDeviceSize used_bytes = 0;
+        uint32_t alloc_count = 0;
+        VkDeviceSize largest_free_range = 0;
+        float fragmentation = 0.0f;
+        std::vector<MemoryChunkStats> chunks;
+    };
+
+    // A single power-of-two size class of small allocations
+    // Fixed size slots are carved out of slabs (larger ranges of a pool chunk) and kept on a lock-free free list
+    // Slabs are only ever added, so a slot id stays valid for the lifetime of the pool
+    class MemorySlabClass {
+    public:
+        // Slot ids are (slab index << SLOT_BITS | slot index) + 1, so 0 can mean "no slot"
+        static constexpr uint32_t SLOT_BITS = 16;
+        static constexpr uint32_t MAX_SLABS = 1024;
+        static constexpr uint32_t NO_SLOT = 0;
+
+        struct Slab {
+            size_t chunk_index;
+            VkBuffer vk_buffer;
+            VkDeviceAddress vk_chunk_address;
+            VkDeviceSize offset;
+
+            // The next free slot after each slot, only meaningful while the slot is on the free list
+            std::unique_ptr<std::atomic<uint32_t>[]> next;
+
+            // Slots currently handed out, only used for reporting
+            std::atomic<uint32_t> used_slots {0};
+        };
+
+    protected:
+        VkDeviceSize slot_size;
+        uint32_t slots_per_slab;
+
+        std::unique_ptr<std::atomic<Slab*>[]> slabs;
+        std::atomic<uint32_t> slab_count = 0;
+
+        // The top of the free list in the low 32 bits, and a counter bumped on every change in the high 32 bits
+        // The counter stops a slot that was popped and pushed back in the meantime from looking unchanged (ABA)
+        std::atomic<uint64_t> free_head = 0;
+
+        Slab *get_slab(uint32_t slot_id) const;
+
+    public:
+        MemorySlabClass() = delete;
+        MemorySlabClass(VkDeviceSize slot_size, VkDeviceSize slab_size);
+        ~MemorySlabClass();
+
+        // Takes a free slot, returns false if the class needs another slab
+        bool pop(uint32_t &slot_id);
+
+        // Returns a slot to the free list
+        void push(uint32_t slot_id);
+
+        // Hands every slot of a freshly allocated slab out to the free list, returns false if the class is full
+        bool add_slab(size_t chunk_index, VkBuffer vk_buffer, VkDeviceAddress vk_chunk_address, VkDeviceSize offset);
+
+        VkBuffer get_vk_buffer(uint32_t slot_id) const;
+        VkDeviceAddress get_vk_chunk_address(uint32_t slot_id) const;
+        VkDeviceSize get_vk_offset(uint32_t slot_id) const;
+        size_t get_chunk_index(uint32_t slot_id) const;
+
+        [[nodiscard]]
+        VkDeviceSize get_slot_size() const {
+            return slot_size;
+        }
+
+        [[nodiscard]]
+        uint32_t get_slab_count() const {
+            return slab_count;
+        }
+
+        [[nodiscard]]
+        uint32_t get_slots_per_slab() const {
+            return slots_per_slab;
+        }
+
+        // Slabs are indexed in the order they were added, [0, get_slab_count())
+        [[nodiscard]]
+        const Slab *get_slab_at(uint32_t slab_index) const {
+            return slabs[slab_index].load(std::memory_order_acquire);
+        }
+    };
+
+    // A growable set of chunks, each one a VkBuffer broken up by a VMA virtual block
+    // Pools start empty, chunks are created on demand and grow geometrically up to max_chunk_size
+    // Chunks that have been empty for long enough are given back to the driver
+    // Allocating and releasing blocks is safe from any thread, defragment() and collect() belong to the main thread
     // TODO: Track our allocations intelligently?
-    // TODO: Actually make this a pool
     class MemoryPool {
     protected:
-        // TODO: Actually multiple v-allocs if we go over the buffer size!!!
+        VulkanProvider *p_provider = nullptr;
+
+        // Guards the chunks and their block registries
+        std::mutex mutex;
+
+        // Released chunks leave an empty slot behind (vk_buffer == nullptr) so chunk indices stay stable
         std::vector<MemoryPoolChunk> chunks;
-        size_t size;
+        size_t next_chunk_size;
+        size_t max_chunk_size;
         uint32_t usage;
         uint32_t flags;
+        VkMemoryPropertyFlags required_properties;
+
+        // Uniform and storage buffer pools align every block so it can be bound as a descriptor on its own
+        VkDeviceSize block_alignment = 0;
+
+        static constexpr size_t NO_CHUNK = -1;
+
+        // The chunk currently being emptied by defragment()
+        size_t defrag_chunk = NO_CHUNK;
+
+        // Allocations up to SLAB_MAX_SLOT bytes are served by size classes of SLAB_MIN_SLOT, SLAB_MIN_SLOT * 2, ... bytes
+        // Slabs are aligned to SLAB_ALIGNMENT, so a slot is only aligned to its own size (capped at SLAB_ALIGNMENT)
+        // That covers vertex and index data, blocks needing more (descriptor offsets) are served by a larger class, see alloc_slot
+        // Slabs are never given back to their chunk, even once all of their slots are free, so such chunks are never released
+        static constexpr VkDeviceSize SLAB_MIN_SLOT = 64;
+        static constexpr VkDeviceSize SLAB_MAX_SLOT = 4096;
+        static constexpr VkDeviceSize SLAB_SIZE = 64 * 1024;
+        static constexpr VkDeviceSize SLAB_ALIGNMENT = 256;
+
+        std::vector<std::unique_ptr<MemorySlabClass>> slab_classes;
+
+        // Creates a chunk of at least chunk_size bytes, returns its index
+        virtual size_t push_chunk(size_t chunk_size);
+        virtual void release_chunk(size_t chunk_index);
+
+        // Allocates a raw range from any chunk, growing the pool if needed
+        // Requires the mutex to be held
+        void alloc_range(VkDeviceSize size, VkDeviceSize alignment, size_t &chunk_index, VmaVirtualAllocation &vma_valloc, VkDeviceSize &offset);
+
+        // Serves a small allocation from its size class, returns a null handle if the class can't grow any further
+        MemoryBlockHandle alloc_slot(size_t size);
+
+        // Gives a freshly allocated block its bindless index, if the pool is usable as a storage buffer
+        void register_bindless(MemoryBlock *p_block);
+
+        // Queues the block's range (or slot) to be freed once every frame that could be reading it has finished
+        // The block is removed from the provider's table right away, requires the mutex to be held
+        void release_block(MemoryBlock *p_block);
 
-        virtual void push_chunk(VulkanProvider *p_provider);
+        // Picks the emptiest chunk whose blocks fit in the free space of the others
+        size_t find_defrag_chunk();
 
     public:
         MemoryPool() = delete;
-        MemoryPool(VulkanProvider *p_provider, size_t size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags);
+        MemoryPool(VulkanProvider *p_provider, size_t min_chunk_size, size_t max_chunk_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkMemoryPropertyFlags required_properties = 0);
 
-        std::shared_ptr<MemoryBlock> alloc(size_t size);
+        // Allocations larger than max_chunk_size get a dedicated chunk of their own
+        // Small allocations skip VMA and come from a slab, usually without taking a lock
+        // The block counts as uploading (and can't be moved or released) until complete_upload() is called
+        MemoryBlockHandle alloc(size_t size);
+
+        // Writes straight into the block from the CPU, returns false if this pool isn't host visible
+        virtual bool write(MemoryBlock *p_block, const void *src, size_t size);
+
+        // Releases the block, or marks it to be released once its pending upload or move has landed
+        void destroy(MemoryBlock *p_block);
+
+        // Called once the block's contents are in place, releases it if it was destroyed in the meantime
+        void complete_upload(MemoryBlock *p_block);
+
+        // Queues the range to be freed once every frame that could be reading it has finished
+        void release(size_t chunk_index, VmaVirtualAllocation vma_valloc);
+
+        // Frees the range immediately, the GPU must no longer be using it
+        void free(size_t chunk_index, VmaVirtualAllocation vma_valloc);
+
+        // Releases chunks that have been empty for at least idle_frames frames, or that were emptied by defragment()
+        virtual void collect(uint64_t frame_number, uint64_t idle_frames);
+
+        // Moves up to budget bytes of blocks out of the emptiest chunk into the others
+        // The copies ride along with the next staging flush, returns the amount of bytes queued
+        VkDeviceSize defragment(StagingMemoryPool *p_staging, VkDeviceSize budget);
+
+        // Called once a move has landed, points the block at its new range and frees the old one
+        // If the block was destroyed in the meantime, both ranges are freed
+        void complete_move(MemoryBlock *p_block, size_t dst_chunk_index, VmaVirtualAllocation vma_dst_valloc, VkDeviceSize dst_offset);
+
+        // Walks every chunk, slab slots are counted one by one, free slots count as free (but scattered) space
+        virtual MemoryPoolStats get_stats();
+
+        // VMA's JSON map of every range in the chunk, or "null" if the chunk doesn't exist
+        virtual std::string get_detailed_map(size_t chunk_index);
+    };
+
+    // A MemoryPool whose chunks stay mapped for their whole lifetime
+    // Used for device local memory the CPU can see (ReBAR / UMA), so uploads are a plain memcpy
+    // Once the mappable heap (ReBAR / UMA) runs out, new chunks are plain device local memory and their blocks are staged
+    class MappedMemoryPool : public MemoryPool {
+    protected:
+        // nullptr for chunks that aren't host visible, writes to those fall back to staging
+        std::vector<char*> handles {};
+
+        size_t push_chunk(size_t chunk_size) override;
+        void release_chunk(size_t chunk_index) override;
+        void validate_handles();
+
+    public:
+        MappedMemoryPool() = delete;
+        MappedMemoryPool(VulkanProvider *p_provider, size_t min_chunk_size, size_t max_chunk_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkMemoryPropertyFlags required_properties = 0);
+
+        // Returns false for blocks in chunks that aren't mapped, so the caller stages them instead
+        bool write(MemoryBlock *p_block, const void *src, size_t size) override;
     };
 
     // The same as a MemoryPool except that we transfer the copy data over instantly into our mapped buffer handles
-    class StagingMemoryPool : public MemoryPool {
+    // The first chunk is used as a linear ring, regions are reclaimed once the batch reading them has retired
+    // Any thread may enqueue uploads, each one copies into its own arena of the ring without locking
+    // Flushing, moves and retiring batches belong to the thread that created the pool
+    class StagingMemoryPool : public MappedMemoryPool {
     protected:
+        // A region of the ring owned by a single thread, filled front to back
+        // Sealed arenas are handed to the next flush and never written again
+        struct StagingArena {
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            VkDeviceSize used = 0;
+            std::atomic<uint32_t> writers = 0;
+            std::atomic<bool> sealed = false;
+        };
+
+        // A single copy out of the ring, uploads larger than the ring are split into several pieces
+        // The sequence keeps uploads of equal priority (and the pieces of one upload) in order
+        // Destinations can't be released until their final piece has landed, see MemoryPool::destroy
         struct StagedUpload {
-            std::shared_ptr<MemoryBlock> dst_block;
-            std::shared_ptr<MemoryBlock> src_block;
+            MemoryBlock *p_dst_block;
+            VkDeviceSize src_offset;
+            VkDeviceSize dst_offset;
             size_t size;
+            bool final_piece;
+            VulkanProvider::UploadPriority priority;
+            uint64_t sequence;
+            uint64_t generation;
         };
 
-        std::vector<char*> handles {};
-        std::vector<StagedUpload> upload_queue;
+        // Orders the pending queue so the top is the highest priority, oldest upload
+        struct UploadOrder {
+            bool operator()(const StagedUpload &lhs, const StagedUpload &rhs) const {
+                if (lhs.priority != rhs.priority) {
+                    return lhs.priority < rhs.priority;
+                }
+
+                return lhs.sequence > rhs.sequence;
+            }
+        };
+
+        // The ring bytes charged by a single flush, and how many uploads drained by that flush haven't landed yet
+        // Uploads may be submitted out of order, so bytes are only given back once every older generation is done too
+        struct RingGeneration {
+            VkDeviceSize bytes;
+            size_t remaining;
+        };
+
+        // A block being copied to a new range by defragmentation
+        struct StagedMove {
+            MemoryBlock *p_block;
+            MemoryPool *p_pool;
+            size_t dst_chunk_index;
+            VmaVirtualAllocation vma_dst_valloc;
+            VkBuffer vk_dst_buffer;
+            VkDeviceSize dst_offset;
+        };
+
+        // A group of uploads submitted together, kept alive until its fence signals
+        // With a dedicated transfer queue, moves are copied by the graphics queue so their source ranges never change owner
+        // Either command buffer may be nullptr if the batch had nothing for that queue
+        struct UploadBatch {
+            std::vector<StagedUpload> uploads;
+            std::vector<StagedMove> moves;
+            VkCommandBuffer vk_transfer_buffer = nullptr;
+            VkCommandBuffer vk_acquire_buffer = nullptr;
+            VkSemaphore vk_semaphore = nullptr;
+            VkFence vk_fence = nullptr;
+        };
+
+        // Every copy between one pair of buffers, with adjacent regions merged
+        // Only lives for the flush that built it, so the regions come from the frame arena
+        struct CopyGroup {
+            VkBuffer vk_src_buffer = nullptr;
+            VkBuffer vk_dst_buffer = nullptr;
+            FrameVector<VkBufferCopy> regions;
 
-        void push_chunk(Sapphire::Graphics::VulkanProvider *p_provider) override;
-        void validate_handles(VulkanProvider *p_provider);
+            CopyGroup(FrameArena *p_arena, VkBuffer vk_src_buffer, VkBuffer vk_dst_buffer)
+                : vk_src_buffer(vk_src_buffer), vk_dst_buffer(vk_dst_buffer), regions(p_arena) {}
+        };
+
+        const VkDeviceSize RING_ALIGNMENT = 16;
+
+        // How much of the ring a thread grabs at once, larger pieces get an arena of their own size
+        const VkDeviceSize ARENA_SIZE = 1024 * 1024;
+
+        MPSCQueue<StagedUpload> upload_queue;
+        std::vector<StagedMove> move_queue;
+
+        // Uploads drained from upload_queue that haven't been submitted yet, they wait here while over budget
+        std::priority_queue<StagedUpload, std::vector<StagedUpload>, UploadOrder> pending_uploads;
+        uint64_t next_sequence = 0;
+
+        // How many bytes of uploads a flush submits, 0 means no limit
+        VkDeviceSize upload_budget = 0;
+
+        // Oldest first, first_generation is the id of the front entry
+        std::deque<RingGeneration> ring_generations;
+        uint64_t first_generation = 0;
+
+        // The arena the calling thread is writing into, along with the pool it belongs to
+        static thread_local std::shared_ptr<StagingArena> tls_arena;
+        static thread_local StagingMemoryPool *tls_arena_owner;
+
+        // Guards the ring counters and live_arenas, ring_space is signalled whenever a batch gives its bytes back
+        std::mutex ring_mutex;
+        std::condition_variable ring_space;
+
+        // Arenas handed out since the last flush
+        std::vector<std::shared_ptr<StagingArena>> live_arenas;
+
+        // Only this thread may flush, other threads wait for it to free up the ring
+        std::thread::id flush_thread;
+
+        // Where the next region is carved from, and how many bytes are still owned by queued or in-flight uploads
+        // Bytes skipped when wrapping around are counted as used until their generation is released
+        VkDeviceSize ring_head = 0;
+        VkDeviceSize ring_used = 0;
+        VkDeviceSize ring_pending = 0;
+
+        // Oldest batch first, batches are submitted in order so they also retire in order
+        std::deque<UploadBatch> inflight_batches;
+
+        // Retired batches keep their (cleared) lists, so steady streaming doesn't have to grow them again
+        std::vector<UploadBatch> free_batches;
+
+        // Scratch lists for flush(), kept around for their capacity
+        std::vector<std::shared_ptr<StagingArena>> sealed_arenas;
+        std::vector<StagedUpload> drained_uploads;
+
+        // Recycled sync objects and command buffers from retired batches
+        std::vector<VkCommandBuffer> free_transfer_buffers;
+        std::vector<VkCommandBuffer> free_graphics_buffers;
+        std::vector<VkSemaphore> free_semaphores;
+        std::vector<VkFence> free_fences;
+
+        // The ring isn't created until the first upload, and lives in chunk 0 from then on
+        VkDeviceSize ring_size;
+
+        // Groups uploads and / or moves by (src, dst) buffer pair so each pair needs a single vkCmdCopyBuffer
+        FrameVector<CopyGroup> coalesce_copies(VulkanProvider *p_provider, const UploadBatch &batch, bool uploads, bool moves);
+
+        // Records the queue family ownership release / acquire barriers for the copied regions
+        void record_ownership_transfer(VulkanProvider *p_provider, const FrameVector<CopyGroup> &groups, VkCommandBuffer vk_release_buffer, VkCommandBuffer vk_acquire_buffer);
+
+        // Records the copies of every move on the graphics queue, along with the barriers around them
+        void record_moves(VulkanProvider *p_provider, const UploadBatch &batch, VkCommandBuffer vk_cmd_buffer);
+
+        // Carves a contiguous region out of the ring, returns false if there isn't enough free space
+        // Requires ring_mutex to be held
+        bool try_reserve(VkDeviceSize size, VkDeviceSize &offset);
+
+        // Hands the calling thread a fresh arena of at least size bytes, blocking until the ring has room
+        std::shared_ptr<StagingArena> acquire_arena(VulkanProvider *p_provider, VkDeviceSize size);
+
+        // Retires the oldest batch if it has finished (or always if wait is true)
+        bool retire_front(VulkanProvider *p_provider, bool wait);
+
+        // Retires finished batches, marking their destinations as uploaded
+        // If wait is true, blocks until every batch has finished
+        void retire(VulkanProvider *p_provider, bool wait);
+
+        // Gives the ring bytes of every finished generation at the front back
+        void release_generations();
 
     public:
         StagingMemoryPool() = delete;
-        StagingMemoryPool(VulkanProvider *p_provider, size_t size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags);
+        StagingMemoryPool(VulkanProvider *p_provider, size_t ring_size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags);
+
+        // The ring is small and in constant use, so it is never collected
+        void collect(uint64_t frame_number, uint64_t idle_frames) override;
+
+        // The ring isn't tracked by VMA, bytes owned by queued and in-flight uploads count as used
+        MemoryPoolStats get_stats() override;
+        std::string get_detailed_map(size_t chunk_index) override;
+
+        // Flushes the upload queue, submits up to the upload budget on the transfer queue without waiting
+        // Destinations are marked as uploaded once a later flush (or await) sees their batch has finished
+        // Seals every live arena, so uploads racing with the flush land in either this batch or the next one
+        void flush(VulkanProvider *p_provider, bool ignore_budget = false);
+
+        // Submits everything still queued, then blocks until every in-flight batch has finished
+        void await(VulkanProvider *p_provider);
+
+        void set_upload_budget(VkDeviceSize bytes);
 
-        // Flushes the upload queue, uploads everything synchronously
-        // TODO: Async flushing?
-        void flush(VulkanProvider *p_provider);
+        // Copies src into the ring right away, if the ring is full this flushes and waits on the oldest batches
+        // Safe from any thread, threads other than the flushing one wait for the next flush to free up space instead
+        void enqueue_upload(VulkanProvider *p_provider, size_t size, void* src, MemoryBlock *p_dst, VulkanProvider::UploadPriority priority);
 
-        // TODO: Async????????
-        void enqueue_upload(size_t size, void* src, std::shared_ptr<Graphics::MemoryBlock> dst);
+        // Queues a GPU copy of the block into an already allocated range of the pool, see MemoryPool::defragment
+        void enqueue_move(MemoryPool *p_pool, MemoryBlock *p_block, size_t dst_chunk_index, VmaVirtualAllocation vma_dst_valloc, VkBuffer vk_dst_buffer, VkDeviceSize dst_offset);
     };
 }
 
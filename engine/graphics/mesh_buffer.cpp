@@ -25,6 +25,7 @@ SOFTWARE.
 #include "mesh_buffer.hpp"
 
 #include <graphics/memory_block.hpp>
+#include <graphics/uniform_ring.hpp>
 #include <graphics/vulkan_provider.hpp>
 
 #include <stdexcept>
@@ -42,24 +43,74 @@ Graphics::MeshBuffer::MeshBuffer(VulkanProvider *p_provider, const std::vector<V
     size_t vertex_size = vertices.size() * sizeof(Vertex);
     size_t index_size = triangles.size() * sizeof(uint32_t);
 
-    mb_vertices = p_provider->upload_memory(vertex_size, (void*)vertices.data(), VulkanProvider::AllocationType::Mesh);
-    mb_triangles = p_provider->upload_memory(index_size, (void*)triangles.data(), VulkanProvider::AllocationType::Mesh);
+    auto blocks = p_provider->upload_memory({
+        {vertex_size, (void*)vertices.data(), VulkanProvider::AllocationType::Mesh},
+        {index_size, (void*)triangles.data(), VulkanProvider::AllocationType::Mesh}
+    });
+
+    mb_vertices = blocks[0];
+    mb_triangles = blocks[1];
     element_count = triangles.size();
 }
 
-void Graphics::MeshBuffer::draw(VkCommandBuffer vk_cmd_buffer) {
+void Graphics::MeshBuffer::release(VulkanProvider *p_provider) {
+    p_provider->destroy_memory_block(mb_vertices);
+    p_provider->destroy_memory_block(mb_triangles);
+
+    mb_vertices = {};
+    mb_triangles = {};
+}
+
+void Graphics::MeshBuffer::draw(VulkanProvider *p_provider, VkCommandBuffer vk_cmd_buffer, const glm::mat4 &local_to_world) {
+    MemoryBlock *p_vertices = p_provider->get_memory_block(mb_vertices);
+    MemoryBlock *p_triangles = p_provider->get_memory_block(mb_triangles);
+
+    if (p_vertices == nullptr || p_triangles == nullptr) {
+        return;
+    }
+
     // TODO: Do something other than just "not draw" when not loaded in?
-    if (!mb_vertices->is_uploaded() || !mb_triangles->is_uploaded()) {
+    if (!p_vertices->is_uploaded() || !p_triangles->is_uploaded()) {
         return;
     }
 
-    VkBuffer vertex_buffer = mb_vertices->get_vk_buffer();
-    VkBuffer triangle_buffer = mb_triangles->get_vk_buffer();
+    VkBuffer vertex_buffer = p_vertices->get_vk_buffer();
+    VkBuffer triangle_buffer = p_triangles->get_vk_buffer();
 
-    VkDeviceSize vertex_offset = mb_vertices->get_vk_offset();
-    VkDeviceSize triangle_offset = mb_triangles->get_vk_offset();
+    VkDeviceSize vertex_offset = p_vertices->get_vk_offset();
+    VkDeviceSize triangle_offset = p_triangles->get_vk_offset();
 
     vkCmdBindVertexBuffers(vk_cmd_buffer, 0, 1, &vertex_buffer, &vertex_offset);
     vkCmdBindIndexBuffer(vk_cmd_buffer, triangle_buffer, triangle_offset, VK_INDEX_TYPE_UINT32);
+
+    // Each draw gets its own slice of this frame's region, so targets can record in parallel
+    UniformRing *p_ring = p_provider->get_uniform_ring();
+    UniformRing::Allocation allocation = p_ring->alloc(sizeof(DrawConstants));
+    DrawConstants *p_constants = reinterpret_cast<DrawConstants*>(allocation.p_data);
+
+    p_constants->local_to_world = local_to_world;
+    p_constants->world_to_local = glm::inverse(local_to_world);
+
+    p_ring->bind(vk_cmd_buffer, UniformRing::SetDraw, allocation.dynamic_offset);
     vkCmdDrawIndexed(vk_cmd_buffer, element_count, 1, 0, 0, 0);
 }
+
+VkDeviceAddress Graphics::MeshBuffer::get_vk_vertex_address(VulkanProvider *p_provider) {
+    MemoryBlock *p_vertices = p_provider->get_memory_block(mb_vertices);
+
+    if (p_vertices == nullptr || !p_vertices->is_uploaded()) {
+        return 0;
+    }
+
+    return p_vertices->get_vk_address();
+}
+
+VkDeviceAddress Graphics::MeshBuffer::get_vk_triangle_address(VulkanProvider *p_provider) {
+    MemoryBlock *p_triangles = p_provider->get_memory_block(mb_triangles);
+
+    if (p_triangles == nullptr || !p_triangles->is_uploaded()) {
+        return 0;
+    }
+
+    return p_triangles->get_vk_address();
+}
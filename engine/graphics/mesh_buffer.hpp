@@ -29,20 +29,18 @@ SOFTWARE.
 
 #include <vulkan/vulkan.h>
 
+#include <graphics/vulkan_provider.hpp>
+
 #include <vector>
-#include <memory>
 
 namespace Sapphire::Graphics {
-    class MemoryBlock;
-    class VulkanProvider;
-
     // An abstraction over mesh data inside of Vulkan
-    // Automatically handles allocation and deallocation
-    // Should be passed around with shared_ptr's!
+    // Created and destroyed through the provider, see VulkanProvider::create_mesh_buffer
+    // Should be passed around as a MeshBufferHandle!
     class MeshBuffer {
     protected:
-        std::shared_ptr<MemoryBlock> mb_vertices;
-        std::shared_ptr<MemoryBlock> mb_triangles;
+        MemoryBlockHandle mb_vertices;
+        MemoryBlockHandle mb_triangles;
         VkDeviceSize element_count;
 
     public:
@@ -53,15 +51,31 @@ namespace Sapphire::Graphics {
             glm::vec2 uv0;
         };
 
+        // Mirrors CBUFFER_DRAW in sapphire_common.glsl (std140)
+        struct DrawConstants {
+            glm::mat4 local_to_world;
+            glm::mat4 world_to_local;
+        };
+
         // TODO: Allow updating the data post-creation?
         // TODO: Allow keeping the data on the CPU afterward?
 
         MeshBuffer() = delete;
         MeshBuffer(VulkanProvider* p_provider, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& triangles);
 
+        // Destroys the vertex and index blocks, called by VulkanProvider::destroy_mesh_buffer
+        void release(VulkanProvider *p_provider);
+
         // TODO: More safety around this?
         // e.g. requiring the shader has the same vertex data?
-        void draw(VkCommandBuffer vk_cmd_buffer);
+        // Writes the per-draw constants to the uniform ring and binds them to UniformRing::SetDraw
+        void draw(VulkanProvider *p_provider, VkCommandBuffer vk_cmd_buffer, const glm::mat4 &local_to_world = glm::mat4(1.0f));
+
+        // The GPU addresses of the vertices and triangles, for pulling them through pointers, see sapphire_address.glsl
+        // 0 while the blocks are missing or still uploading, or without VK_KHR_buffer_device_address
+        // Blocks can be moved by defragmentation, so fetch these every frame
+        VkDeviceAddress get_vk_vertex_address(VulkanProvider *p_provider);
+        VkDeviceAddress get_vk_triangle_address(VulkanProvider *p_provider);
     };
 }
 
@@ -0,0 +1,160 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "present_thread.hpp"
+
+#include <graphics/vulkan_provider.hpp>
+#include <graphics/targets/window_render_target.hpp>
+
+#include <stdexcept>
+
+using namespace Sapphire;
+
+void Graphics::PresentThread::run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return !requests.empty() || !running; });
+        }
+
+        // Requests still queued on shutdown are presented first, their semaphores have already been signalled
+        Request request;
+
+        if (!requests.try_pop(request)) {
+            break;
+        }
+
+        Clock::time_point start_time = Clock::now();
+
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+        Result present_result {};
+        present_result.count = request.count;
+
+        present_info.waitSemaphoreCount = request.count;
+        present_info.pWaitSemaphores = request.vk_wait_semaphores;
+
+        present_info.swapchainCount = request.count;
+        present_info.pSwapchains = request.vk_swapchains;
+        present_info.pImageIndices = request.image_indices;
+        present_info.pResults = present_result.results;
+
+        VkResult result;
+
+        {
+            // Both the queue and the swapchains are externally synchronized, the main thread submits and acquires on them too
+            // The swapchains are always locked in request order, and the main thread never holds more than one at once
+            VulkanProvider::Queue queue = p_provider->get_queue(VulkanProvider::QueueType::Present);
+
+            std::lock_guard<std::mutex> queue_lock(*queue.p_mutex);
+
+            for (uint32_t s = 0; s < request.count; s++) {
+                request.p_targets[s]->get_swapchain_mutex().lock();
+            }
+
+            result = vkQueuePresentKHR(queue.vk_queue, &present_info);
+
+            for (uint32_t s = 0; s < request.count; s++) {
+                request.p_targets[s]->get_swapchain_mutex().unlock();
+            }
+        }
+
+        for (uint32_t s = 0; s < request.count; s++) {
+            present_result.p_targets[s] = request.p_targets[s];
+        }
+
+        present_result.timing.frame_number = request.frame_number;
+        present_result.timing.result = result;
+        present_result.timing.present_time = Clock::now();
+        present_result.timing.queue_duration = start_time - request.queue_time;
+        present_result.timing.present_duration = present_result.timing.present_time - start_time;
+
+        // Dropped if the main thread stops polling, an out of date swapchain is still caught by the next acquire
+        results.try_push(present_result);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+
+        done.notify_all();
+    }
+}
+
+Graphics::PresentThread::PresentThread(Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider was nullptr!");
+    }
+
+    this->p_provider = p_provider;
+
+    thread = std::thread(&PresentThread::run, this);
+}
+
+Graphics::PresentThread::~PresentThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    wake.notify_one();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Graphics::PresentThread::push(const Graphics::PresentThread::Request &request) {
+    // Never happens as long as presents are awaited before acquiring, but don't overwrite anything if it does
+    while (requests.size() == QUEUE_CAPACITY) {
+        await_pending(QUEUE_CAPACITY - 1);
+    }
+
+    pending++;
+    requests.try_push(request);
+
+    // Taking the lock orders the push before the thread's check, so the wakeup can't be missed
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    wake.notify_one();
+}
+
+void Graphics::PresentThread::await_pending(uint32_t max_pending) {
+    if (pending.load() <= max_pending) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this, max_pending]() { return pending.load() <= max_pending; });
+}
+
+bool Graphics::PresentThread::poll(Graphics::PresentThread::Result &out) {
+    return results.try_pop(out);
+}
+
+uint32_t Graphics::PresentThread::get_pending() const {
+    return pending.load();
+}
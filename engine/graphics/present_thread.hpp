@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_PRESENT_THREAD_HPP
+#define SAPPHIRE_PRESENT_THREAD_HPP
+
+#include <vulkan/vulkan.h>
+
+#include <data/spsc_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Sapphire::Graphics {
+    class VulkanProvider;
+    class WindowRenderTarget;
+
+    // How a single present went, reported whether presents run inline or on the present thread
+    struct PresentTiming {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t frame_number = 0;
+        VkResult result = VK_SUCCESS;
+
+        // How long the present waited to be picked up, and how long vkQueuePresentKHR blocked
+        Clock::duration queue_duration {};
+        Clock::duration present_duration {};
+
+        // When vkQueuePresentKHR returned
+        Clock::time_point present_time {};
+    };
+
+    // Presents on a thread of its own, so a blocking vkQueuePresentKHR (FIFO, compositor contention) doesn't hold up the main thread
+    // The main thread queues presents right after submitting, the results come back through poll()
+    class PresentThread {
+    public:
+        using Clock = PresentTiming::Clock;
+
+        // How many swapchains a single present can cover, larger batches are split up
+        static constexpr size_t MAX_SWAPCHAINS = 8;
+
+        // Every swapchain in a request is presented by a single vkQueuePresentKHR
+        struct Request {
+            VkSwapchainKHR vk_swapchains[MAX_SWAPCHAINS] {};
+            uint32_t image_indices[MAX_SWAPCHAINS] {};
+            VkSemaphore vk_wait_semaphores[MAX_SWAPCHAINS] {};
+
+            // Own the swapchains, their swapchain mutexes are held while presenting
+            WindowRenderTarget *p_targets[MAX_SWAPCHAINS] {};
+
+            uint32_t count = 0;
+
+            uint64_t frame_number = 0;
+            Clock::time_point queue_time {};
+        };
+
+        // Each swapchain gets a result of its own, the timing is shared by the whole request
+        struct Result {
+            WindowRenderTarget *p_targets[MAX_SWAPCHAINS] {};
+            VkResult results[MAX_SWAPCHAINS] {};
+
+            uint32_t count = 0;
+
+            PresentTiming timing;
+        };
+
+        // The main thread never gets more than frames in flight presents ahead, so this is plenty
+        static constexpr size_t QUEUE_CAPACITY = 16;
+
+    protected:
+        VulkanProvider *p_provider = nullptr;
+
+        SPSCQueue<Request, QUEUE_CAPACITY> requests;
+        SPSCQueue<Result, QUEUE_CAPACITY> results;
+
+        // Presents pushed that haven't returned yet, only decremented with the mutex held
+        std::atomic<uint32_t> pending {0};
+        bool running = true;
+
+        // wake is signalled when a request is pushed (or on shutdown), done whenever a present returns
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        std::thread thread;
+
+        void run();
+
+    public:
+        PresentThread() = delete;
+        explicit PresentThread(VulkanProvider *p_provider);
+        ~PresentThread();
+
+        PresentThread(const PresentThread&) = delete;
+        PresentThread& operator=(const PresentThread&) = delete;
+
+        // Main thread only
+        void push(const Request &request);
+
+        // Blocks until at most max_pending presents have yet to return
+        void await_pending(uint32_t max_pending);
+
+        // Main thread only, returns false once every result has been taken
+        bool poll(Result &out);
+
+        [[nodiscard]]
+        uint32_t get_pending() const;
+    };
+}
+
+#endif//SAPPHIRE_PRESENT_THREAD_HPP
@@ -35,10 +35,10 @@ void Graphics::IProviderReleasable::release(Graphics::VulkanProvider *p_provider
         throw std::runtime_error("p_provider was nullptr!");
     }
 
-    auto release_func = get_release_func();
+    ReleaseFunction release_func = get_release_func();
 
     if (p_provider->get_defer_release()) {
-        p_provider->enqueue_release(release_func);
+        p_provider->enqueue_release(std::move(release_func));
     } else {
         release_func(p_provider);
     }
@@ -25,14 +25,18 @@ SOFTWARE.
 #ifndef SAPPHIRE_PROVIDER_RELEASABLE_HPP
 #define SAPPHIRE_PROVIDER_RELEASABLE_HPP
 
-#include <functional>
+#include <data/inline_function.hpp>
 
 namespace Sapphire::Graphics {
     class VulkanProvider;
 
+    // Releases are queued every frame, so they're stored inline rather than on the heap
+    // Capture handles and moved-from containers, never copies of containers
+    using ReleaseFunction = InlineFunction<void(VulkanProvider*), 64>;
+
     class IProviderReleasable {
     protected:
-        virtual std::function<void(VulkanProvider*)> get_release_func() = 0;
+        virtual ReleaseFunction get_release_func() = 0;
 
     public:
         virtual void release(VulkanProvider *p_provider);
@@ -117,7 +117,7 @@ void Graphics::RenderPassBuilder::push_subpass_dependency(DependencyInfo depende
     dependency.dstSubpass = dependency_info.dst_subpass;
     dependency.srcStageMask = dependency_info.src_stage_flags;
     dependency.dstStageMask = dependency_info.dst_stage_flags;
-    dependency.srcAccessMask = dependency_info.dst_access_flags;
+    dependency.srcAccessMask = dependency_info.src_access_flags;
     dependency.dstAccessMask = dependency_info.dst_access_flags;
     dependency.dependencyFlags = dependency_info.dependency_flags;
 
@@ -25,8 +25,12 @@ SOFTWARE.
 #include "render_target.hpp"
 
 #include <engine.hpp>
+#include <graphics/bindless_table.hpp>
+#include <graphics/uniform_ring.hpp>
 #include <graphics/vulkan_provider.hpp>
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include <iostream>
 #include <vector>
 
@@ -35,23 +39,108 @@ Sapphire::Graphics::Shader *shader = nullptr;
 
 using namespace Sapphire;
 
-void Graphics::RenderTarget::recalculate_matrices() {
+void Graphics::RenderTarget::recalculate_matrices(Graphics::VulkanProvider *p_provider) {
+    if (dirty_matrix) {
+        camera_to_world = transform.get_local_to_world();
+        world_to_camera = transform.get_world_to_local();
+
+        dirty_matrix = false;
+    }
+
+    // The extent changes whenever the target is resized, so the projection is rebuilt every frame
+    VkExtent2D extent = get_vk_extent();
+    float aspect = extent.height == 0 ? 1.0f : static_cast<float>(extent.width) / static_cast<float>(extent.height);
+
+    projection = glm::perspective(glm::radians(fov), aspect, z_near, z_far);
 
+    // Vulkan clip space has Y pointing down
+    projection[1][1] *= -1.0f;
+
+    // Last frame's constants may still be in use, so they're written to this frame's region every time
+    UniformRing::Allocation allocation = p_provider->get_uniform_ring()->alloc(sizeof(ViewConstants));
+    ViewConstants *p_constants = reinterpret_cast<ViewConstants*>(allocation.p_data);
+
+    p_constants->projection = projection;
+    p_constants->view = projection * world_to_camera;
+    p_constants->world_to_camera = world_to_camera;
+    p_constants->camera_to_world = camera_to_world;
+    p_constants->camera_position = glm::vec4(transform.get_position(), 1.0f);
+
+    view_offset = allocation.dynamic_offset;
 }
 
-void Graphics::RenderTarget::begin_target(Sapphire::Graphics::VulkanProvider *p_provider) {
+VkSemaphore Graphics::RenderTarget::get_vk_wait_semaphore(Graphics::VulkanProvider *) {
+    return nullptr;
+}
+
+VkSemaphore Graphics::RenderTarget::get_vk_signal_semaphore(Graphics::VulkanProvider *) {
+    return nullptr;
+}
+
+void Graphics::RenderTarget::allocate_command_buffers(Graphics::VulkanProvider *p_provider) {
     if (p_provider == nullptr) {
         throw std::runtime_error("p_provider is nullptr!");
     }
 
-    if (dirty_matrix) {
-        recalculate_matrices();
-        dirty_matrix = false;
+    // Command pools are externally synchronized, a pool per target lets targets be recorded on different threads at once
+    if (vk_command_pool == nullptr) {
+        VkCommandPoolCreateInfo pool_create_info{};
+
+        pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_create_info.queueFamilyIndex = p_provider->get_queue(VulkanProvider::QueueType::Graphics).family;
+
+        VkResult result = vkCreateCommandPool(p_provider->get_vk_device(), &pool_create_info, nullptr, &vk_command_pool);
+
+        if (result != VK_SUCCESS) {
+            LOG_GRAPHICS("Error: vkCreateCommandPool failed with error code (" << result << ")");
+            throw std::runtime_error("vkCreateCommandPool failed! Please check the log above for more info!");
+        }
+    }
+
+    while (vk_command_buffers.size() < p_provider->get_frames_in_flight()) {
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = vk_command_pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = 1;
+
+        VkCommandBuffer vk_buffer = nullptr;
+        VkResult result = vkAllocateCommandBuffers(p_provider->get_vk_device(), &alloc_info, &vk_buffer);
+
+        if (result != VK_SUCCESS) {
+            LOG_GRAPHICS("Error: vkAllocateCommandBuffers failed with error code (" << result << ")");
+            throw std::runtime_error("vkAllocateCommandBuffers failed! Please check the log above for more info!");
+        }
+
+        vk_command_buffers.push_back(vk_buffer);
+    }
+}
+
+void Graphics::RenderTarget::free_command_buffers(Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    // Destroying the pool frees its buffers with it
+    if (vk_command_pool != nullptr) {
+        vkDestroyCommandPool(p_provider->get_vk_device(), vk_command_pool, nullptr);
     }
 
-    // TODO: Not lock when other buffers are being processed?
-    VulkanProvider::Queue queue = p_provider->get_queue(VulkanProvider::QueueType::Graphics);
-    p_provider->await_frame();
+    vk_command_pool = nullptr;
+    vk_command_buffers.clear();
+    vk_command_buffer = nullptr;
+}
+
+void Graphics::RenderTarget::begin_target(Sapphire::Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    recalculate_matrices(p_provider);
+
+    // The provider already waited on this frame slot in begin_frame, so its command buffer is free to re-record
+    vk_command_buffer = vk_command_buffers[p_provider->get_frame_index()];
 
     VkRenderPassBeginInfo render_pass_info {};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -61,31 +150,25 @@ void Graphics::RenderTarget::begin_target(Sapphire::Graphics::VulkanProvider *p_
     render_pass_info.renderArea.offset = {0, 0};
     render_pass_info.renderArea.extent = get_vk_extent();
 
-    std::vector<VkClearValue> clear_values;
+    // Targets may be recorded on worker threads, so this can't come from the (main thread only) frame arena
+    VkClearValue clear_values[2] {};
+    uint32_t clear_value_count = 0;
 
     if (clear_flags & ClearFlags::ClearColor) {
-        VkClearValue clear_value{};
-        clear_value.color = clear_color;
-
-        clear_values.push_back(clear_value);
+        clear_values[clear_value_count++].color = clear_color;
     }
 
     if (clear_flags & ClearFlags::ClearDepth) {
-        VkClearValue clear_value{};
-        clear_value.depthStencil = clear_depth_stencil;
-
-        clear_values.push_back(clear_value);
+        clear_values[clear_value_count++].depthStencil = clear_depth_stencil;
     }
 
-    render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-    render_pass_info.pClearValues = clear_values.data();
+    render_pass_info.clearValueCount = clear_value_count;
+    render_pass_info.pClearValues = clear_values;
 
     VkCommandBufferBeginInfo buffer_begin_info{};
     buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    VkCommandBuffer vk_command_buffer = get_vk_command_buffer();
-
     VkResult result = vkBeginCommandBuffer(vk_command_buffer, &buffer_begin_info);
 
     if (result != VK_SUCCESS) {
@@ -109,6 +192,15 @@ void Graphics::RenderTarget::begin_target(Sapphire::Graphics::VulkanProvider *p_
     scissor.offset = {0, 0};
     scissor.extent = extent;
     vkCmdSetScissor(vk_command_buffer, 0, 1, &scissor);
+
+    p_provider->get_uniform_ring()->bind(vk_command_buffer, UniformRing::SetView, view_offset);
+
+    // Bound once for the whole pass, draws only push indices into it
+    BindlessTable *p_bindless = p_provider->get_bindless_table();
+
+    if (p_bindless != nullptr) {
+        p_bindless->bind(vk_command_buffer, p_provider->get_vk_pipeline_layout());
+    }
 }
 
 void Graphics::RenderTarget::end_target(Sapphire::Graphics::VulkanProvider *p_provider) {
@@ -132,38 +224,8 @@ void Graphics::RenderTarget::render(Sapphire::Graphics::VulkanProvider *p_provid
         throw std::runtime_error("p_provider is nullptr!");
     }
 
-    // Await the previous render
-    // TODO: Allow async rendering?
-    VulkanProvider::Queue queue = p_provider->get_queue(VulkanProvider::QueueType::Graphics);
-
-    VkSubmitInfo submit_info{};
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-    // TODO: Fix this for image targets
-    if (1) {
-        VkSemaphore vk_semaphore_available = p_provider->get_image_available_semaphore();
-        VkSemaphore vk_semaphore_finished = p_provider->get_render_finished_semaphore();
-
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = &vk_semaphore_available;
-        submit_info.pWaitDstStageMask = wait_stages;
-
-        submit_info.signalSemaphoreCount = 1;
-        submit_info.pSignalSemaphores = &vk_semaphore_finished;
-    } else {
-        submit_info.waitSemaphoreCount = 0;
-        submit_info.signalSemaphoreCount = 0;
-    }
-
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &vk_command_buffer;
-
-    VkResult result = vkQueueSubmit(queue.vk_queue, 1, &submit_info, p_provider->get_render_fence());
-
-    // TODO: Don't wait for the frame to complete
-    vkQueueWaitIdle(queue.vk_queue);
+    RenderTarget *p_target = this;
+    p_provider->submit_targets(&p_target, 1);
 }
 
 VkCommandBuffer Graphics::RenderTarget::get_vk_command_buffer() const {
@@ -30,6 +30,8 @@ SOFTWARE.
 #include <graphics/provider_releasable.hpp>
 #include <world/transform.hpp>
 
+#include <vector>
+
 namespace Sapphire::Graphics {
     class VulkanProvider;
 
@@ -49,7 +51,22 @@ namespace Sapphire::Graphics {
         };
 
     protected:
+        // Mirrors CBUFFER_VIEW in sapphire_common.glsl (std140)
+        struct ViewConstants {
+            glm::mat4 projection;
+            glm::mat4 view;
+            glm::mat4 world_to_camera;
+            glm::mat4 camera_to_world;
+
+            glm::vec4 camera_position;
+        };
+
         int clear_flags = ClearFlags::All;
+
+        // One command buffer per frame in flight, vk_command_buffer is the one of the frame being recorded
+        // They come from a pool of the target's own, so targets can be recorded in parallel
+        VkCommandPool vk_command_pool = nullptr;
+        std::vector<VkCommandBuffer> vk_command_buffers;
         VkCommandBuffer vk_command_buffer = nullptr;
 
         VkClearColorValue clear_color = {0.1F, 0.1F, 0.1F, 1};
@@ -60,21 +77,38 @@ namespace Sapphire::Graphics {
         glm::mat4 world_to_camera;
         glm::mat4 camera_to_world;
 
-        bool dirty_matrix = false;
+        // Vertical field of view in degrees
+        float fov = 60.0f;
+        float z_near = 0.1f;
+        float z_far = 1000.0f;
+
+        bool dirty_matrix = true;
+
+        // Where this frame's view constants live in the uniform ring
+        uint32_t view_offset = 0;
 
         virtual VkExtent2D get_vk_extent() = 0;
         virtual VkRenderPass get_vk_render_pass(VulkanProvider *p_provider) = 0;
         virtual VkFramebuffer get_vk_framebuffer(VulkanProvider *p_provider) = 0;
 
-        virtual void recalculate_matrices();
+        // Rebuilds the camera matrices if needed, then writes this frame's view constants into the uniform ring
+        virtual void recalculate_matrices(VulkanProvider *p_provider);
+
+        void allocate_command_buffers(VulkanProvider *p_provider);
+        void free_command_buffers(VulkanProvider *p_provider);
 
     public:
         virtual void begin_target(VulkanProvider *p_provider);
         virtual void end_target(VulkanProvider *p_provider);
 
         // Submits the recorded command buffer for rendering
+        // This takes up the frame's submit, use VulkanProvider::submit_targets to render more than one target per frame
         virtual void render(VulkanProvider *p_provider);
 
+        // Semaphores the submit waits on / signals, nullptr if the target doesn't need them (e.g. offscreen images)
+        virtual VkSemaphore get_vk_wait_semaphore(VulkanProvider *p_provider);
+        virtual VkSemaphore get_vk_signal_semaphore(VulkanProvider *p_provider);
+
         [[nodiscard]]
         virtual VkCommandBuffer get_vk_command_buffer() const;
 
@@ -28,6 +28,7 @@ SOFTWARE.
 #include <graphics/vulkan_provider.hpp>
 
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
 using namespace Sapphire;
@@ -85,26 +86,42 @@ VkPipelineShaderStageCreateInfo Graphics::ShaderModule::get_vk_stage_info() {
     return vk_stage_info;
 }
 
-std::function<void(Graphics::VulkanProvider*)> Graphics::Shader::get_release_func() {
-    return [](VulkanProvider* p_provider){
+Graphics::ReleaseFunction Graphics::ShaderModule::get_release_func() {
+    VkShaderModule vk_module = this->vk_module;
 
+    return [vk_module](VulkanProvider* p_provider){
+        vkDestroyShaderModule(p_provider->get_vk_device(), vk_module, nullptr);
     };
 }
 
-void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties properties, const std::vector<std::shared_ptr<ShaderModule>>& shader_modules) {
+Graphics::ReleaseFunction Graphics::Shader::get_release_func() {
+    VkPipeline vk_pipeline = this->vk_pipeline;
+
+    // The pipeline layout belongs to the provider
+    return [vk_pipeline](VulkanProvider* p_provider){
+        vkDestroyPipeline(p_provider->get_vk_device(), vk_pipeline, nullptr);
+    };
+}
+
+void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties properties, std::initializer_list<ShaderModule*> shader_modules) {
     if (p_provider == nullptr) {
         throw std::runtime_error("p_provider was nullptr!");
     }
 
+    // Shaders are compiled on the main thread, so the temporaries can come from the frame arena
+    FrameArena *p_arena = p_provider->get_frame_arena();
+
     //
     // Our inputs
     //
-    std::vector<VkPipelineShaderStageCreateInfo> vk_stage_infos;
+    FrameVector<VkPipelineShaderStageCreateInfo> vk_stage_infos(p_arena);
+    vk_stage_infos.reserve(shader_modules.size());
+
     VkVertexInputBindingDescription vk_vtx_binding = p_provider->get_vk_vtx_binding();
-    std::vector<VkVertexInputAttributeDescription> vk_vtx_attributes = p_provider->get_vk_vtx_attributes();
+    const std::vector<VkVertexInputAttributeDescription>& vk_vtx_attributes = p_provider->get_vk_vtx_attributes();
 
     // TODO: More dynamic states / changing this per platform (e.g. mobile)?
-    const std::vector<VkDynamicState> dynamic_states = {
+    const VkDynamicState dynamic_states[] = {
             VK_DYNAMIC_STATE_VIEWPORT,
             VK_DYNAMIC_STATE_SCISSOR
     };
@@ -196,8 +213,8 @@ void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties prop
     VkPipelineDynamicStateCreateInfo dynamic_state_create_info {};
     dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
 
-    dynamic_state_create_info.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
-    dynamic_state_create_info.pDynamicStates = dynamic_states.data();
+    dynamic_state_create_info.dynamicStateCount = static_cast<uint32_t>(std::size(dynamic_states));
+    dynamic_state_create_info.pDynamicStates = dynamic_states;
 
 
     VkPipelineVertexInputStateCreateInfo vertex_input_create_info {};
@@ -287,25 +304,11 @@ void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties prop
     depth_stencil_state.front = {}; // Optional
     depth_stencil_state.back = {}; // Optional
 
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
-    pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
     // TODO: Tie the descriptor set type to the shader (for pipeline agnostic shaders?)
 
-    // TODO: DESCRIPTOR SETS ASAP!!!
-    std::vector<VkDescriptorSetLayout> vk_descriptor_set_layouts;
-    std::vector<VkPushConstantRange> vk_push_ranges;
-    pipeline_layout_create_info.setLayoutCount = static_cast<uint32_t>(vk_descriptor_set_layouts.size());
-    pipeline_layout_create_info.pSetLayouts = vk_descriptor_set_layouts.data();
-    pipeline_layout_create_info.pushConstantRangeCount = 0; // Optional
-    pipeline_layout_create_info.pPushConstantRanges = nullptr; // Optional
-
-    VkResult result = vkCreatePipelineLayout(p_provider->get_vk_device(), &pipeline_layout_create_info, nullptr, &vk_pipeline_layout);
-
-    if (result != VK_SUCCESS) {
-        LOG_GRAPHICS("Error: vkCreatePipelineLayout failed with error code (" << result << ")");
-        throw std::runtime_error("vkCreatePipelineLayout failed! Please check the log above for more info!");
-    }
+    // Every shader shares the provider's pipeline layout, so sets bound once stay bound across pipelines
+    // See sapphire_common.glsl and sapphire_bindless.glsl
+    vk_pipeline_layout = p_provider->get_vk_pipeline_layout();
 
     //
     // Pipeline creation
@@ -324,12 +327,13 @@ void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties prop
     pipeline_create_info.pColorBlendState = &color_blend_state;
     pipeline_create_info.pDynamicState = &dynamic_state_create_info;
     pipeline_create_info.layout = vk_pipeline_layout;
-    pipeline_create_info.renderPass = p_provider->get_render_pass_window(); // TODO: AGNOSTIC RENDER PASS ASAP!!!
+    // Pipelines only need a compatible pass, the image pass shares the window pass formats and dependencies, and exists with or without a window
+    pipeline_create_info.renderPass = p_provider->get_render_pass_image(); // TODO: AGNOSTIC RENDER PASS ASAP!!!
     pipeline_create_info.subpass = 0; // TODO: Subpasses?
     pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipeline_create_info.basePipelineIndex = -1; // Optional
 
-    result = vkCreateGraphicsPipelines(p_provider->get_vk_device(), nullptr, 1, &pipeline_create_info, nullptr, &vk_pipeline);
+    VkResult result = vkCreateGraphicsPipelines(p_provider->get_vk_device(), nullptr, 1, &pipeline_create_info, nullptr, &vk_pipeline);
 
     if (result != VK_SUCCESS) {
         LOG_GRAPHICS("Error: vkCreateGraphicsPipelines failed with error code (" << result << ")");
@@ -337,7 +341,7 @@ void Graphics::Shader::compile(VulkanProvider *p_provider, ShaderProperties prop
     }
 }
 
-Graphics::Shader::Shader(VulkanProvider *p_provider, ShaderProperties properties, const std::shared_ptr<ShaderModule>& sm_vertex, const std::shared_ptr<ShaderModule>& sm_fragment) {
+Graphics::Shader::Shader(VulkanProvider *p_provider, ShaderProperties properties, ShaderModule *sm_vertex, ShaderModule *sm_fragment) {
     if (sm_vertex == nullptr) {
         throw std::runtime_error("sm_vertex was nullptr!");
     }
@@ -29,6 +29,7 @@ SOFTWARE.
 
 #include <vulkan/vulkan.h>
 
+#include <initializer_list>
 #include <vector>
 #include <string>
 #include <memory>
@@ -92,7 +93,7 @@ namespace Sapphire::Graphics {
         Always
     };
 
-    class ShaderModule {
+    class ShaderModule : public IProviderReleasable {
         //friend class Shader;
 
     public:
@@ -109,6 +110,8 @@ namespace Sapphire::Graphics {
         std::vector<char> data;
         std::string entry_point;
 
+        ReleaseFunction get_release_func() override;
+
         // Passes the SPIR-V binary into our vulkan instance and readies it for usage with a Shader
         void compile(VulkanProvider *p_provider);
 
@@ -150,16 +153,18 @@ namespace Sapphire::Graphics {
     // TODO: Compute shaders?
     class Shader : public IProviderReleasable {
     protected:
-        std::function<void (VulkanProvider *)> get_release_func() override;
+        ReleaseFunction get_release_func() override;
 
         VkPipeline vk_pipeline = nullptr;
         VkPipelineLayout vk_pipeline_layout = nullptr;
 
-        void compile(VulkanProvider *p_provider, ShaderProperties properties, const std::vector<std::shared_ptr<ShaderModule>>& shader_modules);
+        void compile(VulkanProvider *p_provider, ShaderProperties properties, std::initializer_list<ShaderModule*> shader_modules);
 
     public:
         Shader() = delete;
-        Shader(VulkanProvider *p_provider, ShaderProperties properties, const std::shared_ptr<ShaderModule>& sm_vertex, const std::shared_ptr<ShaderModule>& sm_fragment);
+
+        // The modules are only read while compiling, they may be destroyed right after
+        Shader(VulkanProvider *p_provider, ShaderProperties properties, ShaderModule *sm_vertex, ShaderModule *sm_fragment);
 
         void bind(VkCommandBuffer vk_cmd_buffer);
     };
@@ -0,0 +1,142 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_render_target.hpp"
+
+#include <engine.hpp>
+
+#include <graphics/vulkan_provider.hpp>
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <utility>
+
+using namespace Sapphire;
+
+// The images are moved out rather than copied, releasing hands ownership over to the release queue
+Graphics::ReleaseFunction Graphics::ImageRenderTargetData::get_release_func() {
+    return
+        [
+            images = std::move(images)
+        ]
+        (VulkanProvider* p_provider) mutable -> void
+        {
+            for (Image& image: images) {
+                if (image.vk_framebuffer != nullptr) {
+                    vkDestroyFramebuffer(p_provider->get_vk_device(), image.vk_framebuffer, nullptr);
+                }
+
+                if (image.vk_image_view != nullptr) {
+                    vkDestroyImageView(p_provider->get_vk_device(), image.vk_image_view, nullptr);
+                }
+
+                if (image.vk_image != nullptr) {
+                    vmaDestroyImage(p_provider->get_vma_allocator(), image.vk_image, image.vma_allocation);
+                }
+            }
+        };
+}
+
+VkExtent2D Graphics::ImageRenderTarget::get_vk_extent() {
+    return rt_data.vk_extent;
+}
+
+VkRenderPass Graphics::ImageRenderTarget::get_vk_render_pass(Sapphire::Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    return p_provider->get_render_pass_image();
+}
+
+// Nothing to acquire, the provider already waited on this frame slot so its image is free
+VkFramebuffer Graphics::ImageRenderTarget::get_vk_framebuffer(Sapphire::Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    return rt_data.images[p_provider->get_frame_index()].vk_framebuffer;
+}
+
+Graphics::ReleaseFunction Graphics::ImageRenderTarget::get_release_func() {
+    return [=](VulkanProvider* p_provider) mutable{
+        rt_data.release(p_provider);
+
+        // TODO: Safer command buffer allocation?
+        free_command_buffers(p_provider);
+    };
+}
+
+void Graphics::ImageRenderTarget::initialize(Graphics::VulkanProvider *p_provider, VkExtent2D vk_extent) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    p_provider->setup_image_render_target(this, vk_extent);
+
+    allocate_command_buffers(p_provider);
+}
+
+Graphics::ImageRenderTarget::ImageRenderTarget(Engine *p_engine, VkExtent2D vk_extent) {
+    if (p_engine == nullptr) {
+        throw std::runtime_error("p_engine was nullptr!");
+    }
+
+    initialize(p_engine->get_vk_provider(), vk_extent);
+}
+
+Graphics::ImageRenderTarget::ImageRenderTarget(Graphics::VulkanProvider *p_provider, VkExtent2D vk_extent) {
+    initialize(p_provider, vk_extent);
+}
+
+void Graphics::ImageRenderTarget::resize(Graphics::VulkanProvider *p_provider, VkExtent2D vk_extent) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    p_provider->setup_image_render_target(this, vk_extent);
+}
+
+void Graphics::ImageRenderTarget::set_rt_data(Sapphire::Graphics::ImageRenderTargetData rt_data) {
+    this->rt_data = std::move(rt_data);
+}
+
+Graphics::ImageRenderTargetData Graphics::ImageRenderTarget::get_rt_data() {
+    return rt_data;
+}
+
+VkImage Graphics::ImageRenderTarget::get_vk_image(Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    return rt_data.images[p_provider->get_frame_index()].vk_image;
+}
+
+VkImageView Graphics::ImageRenderTarget::get_vk_image_view(Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    return rt_data.images[p_provider->get_frame_index()].vk_image_view;
+}
@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef SAPPHIRE_IMAGE_RENDER_TARGET_HPP
+#define SAPPHIRE_IMAGE_RENDER_TARGET_HPP
+
+#include <graphics/render_target.hpp>
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <vector>
+
+namespace Sapphire {
+    class Engine;
+}
+
+namespace Sapphire::Graphics {
+    class VulkanProvider;
+
+    struct ImageRenderTargetData : public IProviderReleasable {
+        struct Image {
+            VkImage vk_image = nullptr;
+            VmaAllocation vma_allocation = nullptr;
+            VkImageView vk_image_view = nullptr;
+            VkFramebuffer vk_framebuffer = nullptr;
+        };
+
+        VkExtent2D vk_extent {};
+
+        // One image per frame in flight, so a frame never draws over one the GPU is still writing
+        std::vector<Image> images {};
+
+    protected:
+        ReleaseFunction get_release_func() override;
+    };
+
+    // An offscreen render target backed by VMA images, it needs no window, surface or swapchain
+    // Once the frame slot's fence has signaled, the image is in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ready to be copied out
+    class ImageRenderTarget : public RenderTarget {
+    protected:
+        ImageRenderTargetData rt_data;
+
+        VkExtent2D get_vk_extent() override;
+        VkRenderPass get_vk_render_pass(VulkanProvider *p_provider) override;
+        VkFramebuffer get_vk_framebuffer(VulkanProvider *p_provider) override;
+
+        ReleaseFunction get_release_func() override;
+
+        void initialize(VulkanProvider *p_provider, VkExtent2D vk_extent);
+
+    public:
+        ImageRenderTarget() = delete;
+        explicit ImageRenderTarget(Engine *p_engine, VkExtent2D vk_extent);
+        explicit ImageRenderTarget(VulkanProvider *p_provider, VkExtent2D vk_extent);
+
+        // Recreates the images at the new size, the old ones are released once the GPU is done with them
+        void resize(VulkanProvider *p_provider, VkExtent2D vk_extent);
+
+        void set_rt_data(ImageRenderTargetData rt_data);
+        ImageRenderTargetData get_rt_data();
+
+        // The image of the frame slot being recorded
+        VkImage get_vk_image(VulkanProvider *p_provider);
+        VkImageView get_vk_image_view(VulkanProvider *p_provider);
+    };
+}
+
+#endif//SAPPHIRE_IMAGE_RENDER_TARGET_HPP
@@ -29,21 +29,25 @@ SOFTWARE.
 #include <graphics/vulkan_provider.hpp>
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <iostream>
 #include <stdexcept>
+#include <utility>
 
 using namespace Sapphire;
 
-std::function<void(Graphics::VulkanProvider*)> Graphics::WindowRenderTargetData::get_release_func() {
+// The handles are moved out rather than copied, releasing hands ownership over to the release queue
+Graphics::ReleaseFunction Graphics::WindowRenderTargetData::get_release_func() {
     return
         [
-            vk_swapchain = vk_swapchain,
-            vk_images = vk_images,
-            vk_image_views = vk_image_views
+            vk_swapchain = std::exchange(vk_swapchain, nullptr),
+            vk_image_views = std::move(vk_image_views),
+            vk_framebuffers = std::move(vk_framebuffers)
         ]
         (VulkanProvider* p_provider) mutable -> void
         {
-            if (vk_swapchain != nullptr) {
-                vkDestroySwapchainKHR(p_provider->get_vk_device(), vk_swapchain, nullptr);
+            for (VkFramebuffer vk_framebuffer: vk_framebuffers) {
+                vkDestroyFramebuffer(p_provider->get_vk_device(), vk_framebuffer, nullptr);
             }
 
             // Windows do not need to destroy their framebuffer images
@@ -52,6 +56,10 @@ std::function<void(Graphics::VulkanProvider*)> Graphics::WindowRenderTargetData:
             for (VkImageView vk_image_view: vk_image_views) {
                 vkDestroyImageView(p_provider->get_vk_device(), vk_image_view, nullptr);
             }
+
+            if (vk_swapchain != nullptr) {
+                vkDestroySwapchainKHR(p_provider->get_vk_device(), vk_swapchain, nullptr);
+            }
         };
 }
 
@@ -68,26 +76,45 @@ VkRenderPass Graphics::WindowRenderTarget::get_vk_render_pass(Sapphire::Graphics
 }
 
 VkFramebuffer Graphics::WindowRenderTarget::get_vk_framebuffer(Sapphire::Graphics::VulkanProvider *p_provider) {
-    vkAcquireNextImageKHR(
-            p_provider->get_vk_device(),
-            rt_data.vk_swapchain,
-            UINT64_MAX,
-            p_provider->get_image_available_semaphore(),
-            VK_NULL_HANDLE,
-            &rt_data.vk_frame_index);
+    if (acquired_frame != p_provider->get_frame_number() && !acquire(p_provider)) {
+        throw std::runtime_error("No swapchain image could be acquired, the window may be minimized!");
+    }
 
     return rt_data.vk_framebuffers[rt_data.vk_frame_index];
 }
 
-std::function<void(Graphics::VulkanProvider*)> Graphics::WindowRenderTarget::get_release_func() {
+VkSemaphore Graphics::WindowRenderTarget::get_vk_wait_semaphore(Sapphire::Graphics::VulkanProvider *p_provider) {
+    return vk_image_available_semaphores[p_provider->get_frame_index()];
+}
+
+VkSemaphore Graphics::WindowRenderTarget::get_vk_signal_semaphore(Sapphire::Graphics::VulkanProvider *p_provider) {
+    return vk_render_finished_semaphores[p_provider->get_frame_index()];
+}
+
+Graphics::ReleaseFunction Graphics::WindowRenderTarget::get_release_func() {
     return [=](VulkanProvider* p_provider) mutable{
+        // Presents queued before the release may still be using the swapchain
+        if (p_provider->get_present_thread() != nullptr) {
+            p_provider->get_present_thread()->await_pending(0);
+            p_provider->poll_present_thread();
+        }
+
         rt_data.release(p_provider);
 
-        if (vk_command_buffer != nullptr) {
-            // TODO: Safer command buffer allocation?
-            p_provider->free_command_buffer(VulkanProvider::QueueType::Graphics, vk_command_buffer);
+        // TODO: Safer command buffer allocation?
+        free_command_buffers(p_provider);
+
+        for (VkSemaphore vk_semaphore : vk_image_available_semaphores) {
+            vkDestroySemaphore(p_provider->get_vk_device(), vk_semaphore, nullptr);
+        }
+
+        for (VkSemaphore vk_semaphore : vk_render_finished_semaphores) {
+            vkDestroySemaphore(p_provider->get_vk_device(), vk_semaphore, nullptr);
         }
 
+        vk_image_available_semaphores.clear();
+        vk_render_finished_semaphores.clear();
+
         if (vk_surface != nullptr) {
             vkDestroySurfaceKHR(p_provider->get_vk_instance(), vk_surface, nullptr);
         }
@@ -103,16 +130,22 @@ void Graphics::WindowRenderTarget::initialize(Graphics::VulkanProvider *p_provid
         throw std::runtime_error("p_owner is nullptr!");
     }
 
+    this->p_owner = p_owner;
+
     // This assumes we haven't been given a surface beforehand
     // If your surface is nullptr after assigning it, something is wrong :P
     if (vk_surface == nullptr) {
-       p_provider->create_vk_surface(p_owner);
+       vk_surface = p_provider->create_vk_surface(p_owner);
     }
 
     p_provider->setup_window_render_target(this, p_owner);
 
-    if (vk_command_buffer == nullptr) {
-        vk_command_buffer = p_provider->allocate_command_buffer(VulkanProvider::QueueType::Graphics);
+    allocate_command_buffers(p_provider);
+
+    // Recreating keeps the semaphores
+    while (vk_image_available_semaphores.size() < p_provider->get_frames_in_flight()) {
+        vk_image_available_semaphores.push_back(p_provider->create_vk_semaphore());
+        vk_render_finished_semaphores.push_back(p_provider->create_vk_semaphore());
     }
 }
 
@@ -144,27 +177,96 @@ Graphics::WindowRenderTarget::WindowRenderTarget(Graphics::VulkanProvider *p_pro
 
 void Graphics::WindowRenderTarget::recreate(Graphics::VulkanProvider *p_provider, Window *p_owner) {
     initialize(p_provider, p_owner);
+
+    // Anything acquired belonged to the old swapchain
+    acquired_frame = UINT64_MAX;
 }
 
-void Graphics::WindowRenderTarget::present(Graphics::VulkanProvider *p_provider) {
+bool Graphics::WindowRenderTarget::acquire(Graphics::VulkanProvider *p_provider) {
     if (p_provider == nullptr) {
         throw std::runtime_error("p_provider is nullptr!");
     }
 
-    VkSemaphore vk_semaphore_render_finished = p_provider->get_render_finished_semaphore();
-    VulkanProvider::Queue queue = p_provider->get_queue(VulkanProvider::QueueType::Present);
+    PresentThread *p_present_thread = p_provider->get_present_thread();
+
+    // Images queued on the present thread still count as acquired, and an infinite acquire may only leave minImageCount unacquired
+    // Staying under frames in flight also means this frame's semaphores aren't still waited on by an old present
+    if (p_present_thread != nullptr) {
+        uint32_t spare_images = static_cast<uint32_t>(rt_data.vk_images.size()) - rt_data.vk_capabilities.minImageCount;
+        p_present_thread->await_pending(std::min(spare_images, p_provider->get_frames_in_flight() - 1));
+    }
+
+    VkResult result;
 
-    VkPresentInfoKHR present_info{};
-    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    {
+        std::lock_guard<std::mutex> lock(swapchain_mutex);
 
-    present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &vk_semaphore_render_finished;
+        result = vkAcquireNextImageKHR(
+                p_provider->get_vk_device(),
+                rt_data.vk_swapchain,
+                UINT64_MAX,
+                get_vk_wait_semaphore(p_provider),
+                VK_NULL_HANDLE,
+                &rt_data.vk_frame_index);
+    }
+
+    // An out of date swapchain can't be drawn to at all, so it's rebuilt right away rather than next frame
+    // Nothing was acquired, so the semaphore is still unsignaled and can be used again
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        recreate(p_provider, p_owner);
+
+        std::lock_guard<std::mutex> lock(swapchain_mutex);
+
+        result = vkAcquireNextImageKHR(
+                p_provider->get_vk_device(),
+                rt_data.vk_swapchain,
+                UINT64_MAX,
+                get_vk_wait_semaphore(p_provider),
+                VK_NULL_HANDLE,
+                &rt_data.vk_frame_index);
+    }
+
+    // The window was minimized after it was checked, so the swapchain couldn't be rebuilt yet
+    // The frame goes on without this window, it's rebuilt once the surface has an extent again
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        p_owner->mark_dirty();
+        return false;
+    }
+
+    // Suboptimal swapchains still work, so they're rebuilt once the window settles
+    if (result == VK_SUBOPTIMAL_KHR) {
+        p_owner->mark_dirty();
+    } else if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkAcquireNextImageKHR failed with error code (" << result << ")");
+        throw std::runtime_error("vkAcquireNextImageKHR failed! Please check the log above for more info!");
+    }
+
+    acquired_frame = p_provider->get_frame_number();
+    return true;
+}
+
+void Graphics::WindowRenderTarget::present(Graphics::VulkanProvider *p_provider) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider is nullptr!");
+    }
+
+    WindowRenderTarget *p_target = this;
+    p_provider->present_targets(&p_target, 1);
+}
 
-    present_info.swapchainCount = 1;
-    present_info.pSwapchains = &rt_data.vk_swapchain;
-    present_info.pImageIndices = &rt_data.vk_frame_index;
+void Graphics::WindowRenderTarget::handle_present_result(VkResult result) {
+    // The image was still consumed, so there's nothing to undo
+    // The swapchain is rebuilt once the window settles, or by the next acquire if it can't be used anymore
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        p_owner->mark_dirty();
+    } else if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkQueuePresentKHR failed with error code (" << result << ")");
+        throw std::runtime_error("vkQueuePresentKHR failed! Please check the log above for more info!");
+    }
+}
 
-    vkQueuePresentKHR(queue.vk_queue, &present_info);
+std::mutex &Graphics::WindowRenderTarget::get_swapchain_mutex() {
+    return swapchain_mutex;
 }
 
 void Graphics::WindowRenderTarget::set_rt_data(Sapphire::Graphics::WindowRenderTargetData rt_data) {
@@ -178,3 +280,11 @@ Graphics::WindowRenderTargetData Graphics::WindowRenderTarget::get_rt_data() {
 VkSurfaceKHR Graphics::WindowRenderTarget::get_vk_surface() {
     return vk_surface;
 }
+
+VkSwapchainKHR Graphics::WindowRenderTarget::get_vk_swapchain() const {
+    return rt_data.vk_swapchain;
+}
+
+uint32_t Graphics::WindowRenderTarget::get_vk_image_index() const {
+    return rt_data.vk_frame_index;
+}
@@ -30,6 +30,7 @@ SOFTWARE.
 #include <vulkan/vulkan.h>
 
 #include "window.hpp"
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -51,7 +52,7 @@ namespace Sapphire::Graphics {
         std::vector<VkFramebuffer> vk_framebuffers {};
 
     protected:
-        std::function<void (VulkanProvider *)> get_release_func() override;
+        ReleaseFunction get_release_func() override;
     };
 
     class WindowRenderTarget : public RenderTarget {
@@ -59,11 +60,24 @@ namespace Sapphire::Graphics {
         VkSurfaceKHR vk_surface = nullptr;
         WindowRenderTargetData rt_data;
 
+        // The window the swapchain belongs to, out of date swapchains are rebuilt against it
+        Window *p_owner = nullptr;
+
+        // Swapchains are externally synchronized, acquires happen here while the present thread presents
+        std::mutex swapchain_mutex;
+
+        // One of each per frame in flight, every window needs its own so they can be acquired and presented together
+        std::vector<VkSemaphore> vk_image_available_semaphores;
+        std::vector<VkSemaphore> vk_render_finished_semaphores;
+
+        // The frame number the current image was acquired on, so it's only acquired once per frame
+        uint64_t acquired_frame = UINT64_MAX;
+
         VkExtent2D get_vk_extent() override;
         VkRenderPass get_vk_render_pass(VulkanProvider *p_provider) override;
         VkFramebuffer get_vk_framebuffer(VulkanProvider *p_provider) override;
 
-        std::function<void(VulkanProvider*)> get_release_func() override;
+        ReleaseFunction get_release_func() override;
 
         void initialize(VulkanProvider *p_provider, Window *p_owner);
 
@@ -76,12 +90,33 @@ namespace Sapphire::Graphics {
 
         // Recreates the window rt in place (saving allocations)
         void recreate(VulkanProvider* p_provider, Window *p_owner);
+
+        // Acquires this frame's swapchain image, rebuilding the swapchain first if it's out of date
+        // Returns false if it's still out of date (e.g. the window was just minimized), skip the window this frame
+        // Main thread only, call it before recording on another thread, otherwise begin_target acquires
+        bool acquire(VulkanProvider* p_provider);
+
+        // Queued on the provider's present thread if it has one, otherwise presents right away
+        // This takes up the frame's present, use VulkanProvider::present_targets to present more than one window per frame
         void present(VulkanProvider* p_provider);
 
+        // Rendering waits for the acquired image and present waits for rendering
+        VkSemaphore get_vk_wait_semaphore(VulkanProvider *p_provider) override;
+        VkSemaphore get_vk_signal_semaphore(VulkanProvider *p_provider) override;
+
+        // Marks the window dirty for suboptimal / out of date swapchains, throws on anything else that isn't VK_SUCCESS
+        void handle_present_result(VkResult result);
+
+        std::mutex &get_swapchain_mutex();
+
         void set_rt_data(WindowRenderTargetData rt_data);
         WindowRenderTargetData get_rt_data();
 
         VkSurfaceKHR get_vk_surface();
+        VkSwapchainKHR get_vk_swapchain() const;
+
+        // The swapchain image acquired this frame
+        uint32_t get_vk_image_index() const;
     };
 }
 
@@ -0,0 +1,158 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "uniform_ring.hpp"
+
+#include <engine.hpp>
+#include <graphics/descriptor_allocator.hpp>
+#include <graphics/vulkan_provider.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Sapphire;
+
+Graphics::UniformRing::UniformRing(VulkanProvider *p_provider, size_t region_size, uint32_t region_count) {
+    if (p_provider == nullptr) {
+        throw std::runtime_error("p_provider was nullptr!");
+    }
+
+    if (region_count == 0) {
+        throw std::runtime_error("region_count was 0!");
+    }
+
+    this->p_provider = p_provider;
+    this->region_count = region_count;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(p_provider->get_vk_gpu(), &properties);
+
+    // The alignment is always a power of two
+    alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+    this->region_size = (region_size + alignment - 1) & ~(alignment - 1);
+
+    max_range = std::min<VkDeviceSize>(properties.limits.maxUniformBufferRange, this->region_size);
+
+    create_buffer();
+    create_descriptors();
+}
+
+void Graphics::UniformRing::create_buffer() {
+    VkBufferCreateInfo buffer_info = {};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = region_size * region_count + max_range;
+    buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
+    // Coherent memory, so writes never need to be flushed before submitting
+    VmaAllocationCreateInfo alloc_info = {};
+    alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+    alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    alloc_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VmaAllocationInfo vma_alloc_info {};
+    VkResult result = vmaCreateBuffer(p_provider->get_vma_allocator(), &buffer_info, &alloc_info, &vk_buffer, &vma_alloc, &vma_alloc_info);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("vmaCreateBuffer failed with error code (" << result << ")");
+        throw std::runtime_error("vmaCreateBuffer failed! Please check the log above for more info!");
+    }
+
+    handle = reinterpret_cast<char*>(vma_alloc_info.pMappedData);
+}
+
+void Graphics::UniformRing::create_descriptors() {
+    VkDescriptorSetLayoutBinding binding {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Every set index uses the same layout, so a single descriptor set serves all of them
+    // The provider's shared pipeline layout uses it for each of the constants sets
+    vk_set_layout = p_provider->get_descriptor_layout_cache()->get_layout(&binding, 1);
+
+    // The descriptor always points at the start of the buffer, dynamic offsets do the rest
+    DescriptorWrite write {};
+    write.binding = 0;
+    write.vk_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.vk_buffer_info.buffer = vk_buffer;
+    write.vk_buffer_info.offset = 0;
+    write.vk_buffer_info.range = max_range;
+
+    vk_set = p_provider->get_descriptor_set_cache()->get_set(vk_set_layout, &write, 1);
+}
+
+void Graphics::UniformRing::begin_frame(uint32_t frame_index) {
+    region_start = region_size * (frame_index % region_count);
+    region_head = 0;
+}
+
+Graphics::UniformRing::Allocation Graphics::UniformRing::alloc(size_t size) {
+    if (size > max_range) {
+        throw std::runtime_error("Uniform allocation is larger than the maximum descriptor range!");
+    }
+
+    VkDeviceSize aligned_size = (size + alignment - 1) & ~(alignment - 1);
+    VkDeviceSize offset = region_head.fetch_add(aligned_size);
+
+    // TODO: Grow the ring instead?
+    if (offset + aligned_size > region_size) {
+        throw std::runtime_error("Uniform ring is out of space for this frame! Increase EngineConfig::uniform_ring_kib_per_frame");
+    }
+
+    Allocation allocation {};
+    allocation.p_data = handle + region_start + offset;
+    allocation.dynamic_offset = static_cast<uint32_t>(region_start + offset);
+
+    return allocation;
+}
+
+Graphics::UniformRing::Allocation Graphics::UniformRing::write(const void *src, size_t size) {
+    Allocation allocation = alloc(size);
+    memcpy(allocation.p_data, src, size);
+
+    return allocation;
+}
+
+void Graphics::UniformRing::bind(VkCommandBuffer vk_cmd_buffer, uint32_t set, uint32_t dynamic_offset) {
+    if (vk_cmd_buffer == nullptr) {
+        throw std::runtime_error("vk_cmd_buffer was nullptr");
+    }
+
+    if (set >= SetCount) {
+        throw std::runtime_error("set was out of range!");
+    }
+
+    vkCmdBindDescriptorSets(vk_cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_provider->get_vk_pipeline_layout(), set, 1, &vk_set, 1, &dynamic_offset);
+}
+
+VkDescriptorSetLayout Graphics::UniformRing::get_vk_set_layout() {
+    return vk_set_layout;
+}
+
+VkDeviceSize Graphics::UniformRing::get_max_range() const {
+    return max_range;
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SAPPHIRE_UNIFORM_RING_HPP
+#define SAPPHIRE_UNIFORM_RING_HPP
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <atomic>
+
+namespace Sapphire::Graphics {
+    class VulkanProvider;
+
+    // A persistently mapped ring of host visible uniform memory, split into one region per frame in flight
+    // Constants are written straight into the ring and bound through a dynamic offset, so they need neither staging nor new descriptor sets
+    // Everything written during a frame stays valid until that frame slot is reused, nothing is ever freed by hand
+    class UniformRing {
+    public:
+        // The descriptor set indices shared by every pipeline layout
+        enum SetIndex : uint32_t {
+            SetView = 0,
+            SetDraw = 1,
+
+            SetCount = 2
+        };
+
+        struct Allocation {
+            void *p_data = nullptr;
+            uint32_t dynamic_offset = 0;
+        };
+
+    protected:
+        VulkanProvider *p_provider = nullptr;
+
+        VkBuffer vk_buffer = nullptr;
+        VmaAllocation vma_alloc = nullptr;
+        char *handle = nullptr;
+
+        // Region sizes are rounded up to the offset alignment
+        // The buffer has one extra descriptor range of padding at the end so every offset can be bound with the full range
+        VkDeviceSize alignment = 0;
+        VkDeviceSize region_size = 0;
+        VkDeviceSize max_range = 0;
+        uint32_t region_count = 0;
+
+        // Offsets within the region of the current frame, allocations may come from any thread
+        VkDeviceSize region_start = 0;
+        std::atomic<VkDeviceSize> region_head = 0;
+
+        VkDescriptorSetLayout vk_set_layout = nullptr;
+        VkDescriptorSet vk_set = nullptr;
+
+        void create_buffer();
+        void create_descriptors();
+
+    public:
+        UniformRing() = delete;
+        UniformRing(VulkanProvider *p_provider, size_t region_size, uint32_t region_count);
+
+        UniformRing(const UniformRing&) = delete;
+        UniformRing& operator=(const UniformRing&) = delete;
+
+        // Moves onto the region of the given frame slot, the GPU must be done with the frame that last used it
+        void begin_frame(uint32_t frame_index);
+
+        // Carves size bytes out of the current frame's region, the memory is write only and must be filled before submitting
+        Allocation alloc(size_t size);
+
+        // Shorthand for alloc() + memcpy
+        Allocation write(const void *src, size_t size);
+
+        // Binds the ring at the given set, the dynamic offset selects which constants the shader sees
+        void bind(VkCommandBuffer vk_cmd_buffer, uint32_t set, uint32_t dynamic_offset);
+
+        // The layout of a single constants set: one dynamic uniform buffer at binding 0
+        VkDescriptorSetLayout get_vk_set_layout();
+
+        [[nodiscard]]
+        VkDeviceSize get_max_range() const;
+    };
+}
+
+#endif//SAPPHIRE_UNIFORM_RING_HPP
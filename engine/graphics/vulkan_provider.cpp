@@ -24,7 +24,10 @@ SOFTWARE.
 
 #include "vulkan_provider.hpp"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <vector>
 
@@ -39,9 +42,14 @@ SOFTWARE.
 
 #include <data/size_tools.hpp>
 
+#include <graphics/bindless_table.hpp>
+#include <graphics/descriptor_allocator.hpp>
 #include <graphics/memory_block.hpp>
+#include <graphics/mesh_buffer.hpp>
 #include <graphics/render_pass.hpp>
 #include <graphics/shader.hpp>
+#include <graphics/uniform_ring.hpp>
+#include <graphics/targets/image_render_target.hpp>
 #include <graphics/targets/window_render_target.hpp>
 
 #include <shader_gen/fallback.spv.vert.gen.h>
@@ -175,6 +183,40 @@ bool Graphics::VulkanProvider::validate_device_extensions(const std::vector<cons
     return missing_extensions.empty();
 }
 
+bool Graphics::VulkanProvider::is_instance_extension_supported(const char *extension) {
+    std::vector<VkExtensionProperties> supported_extensions;
+    uint32_t extension_count;
+
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+    supported_extensions.resize(extension_count);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, supported_extensions.data());
+
+    for (auto supported : supported_extensions) {
+        if (strcmp(extension, supported.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Graphics::VulkanProvider::is_device_extension_supported(const char *extension) {
+    std::vector<VkExtensionProperties> supported_extensions;
+    uint32_t extension_count;
+
+    vkEnumerateDeviceExtensionProperties(vk_gpu, nullptr, &extension_count, nullptr);
+    supported_extensions.resize(extension_count);
+    vkEnumerateDeviceExtensionProperties(vk_gpu, nullptr, &extension_count, supported_extensions.data());
+
+    for (auto supported : supported_extensions) {
+        if (strcmp(extension, supported.extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Graphics::VulkanProvider::cache_surface_info(VkSurfaceKHR vk_surface) {
     uint32_t enumeration_count;
 
@@ -239,23 +281,18 @@ VkPresentModeKHR Graphics::VulkanProvider::find_supported_present_mode(const std
 }
 
 void Graphics::VulkanProvider::determine_present_info() {
-    // TODO: Make these configurable
-    const bool sRGB = false;
-    const bool d32 = false;
-    const bool vsync = false;
-
     // Try to guess a fitting present format
     std::vector<VkFormat> vk_formats;
     std::vector<VkFormat> vk_depth_formats;
 
-    if (sRGB) {
+    if (srgb) {
         vk_formats.push_back(VK_FORMAT_B8G8R8A8_SRGB);
-    } else {
-        vk_formats.push_back(VK_FORMAT_B8G8R8A8_UNORM);
     }
 
+    vk_formats.push_back(VK_FORMAT_B8G8R8A8_UNORM);
+
     if (d32) {
-        vk_formats.push_back(VK_FORMAT_D32_SFLOAT_S8_UINT);
+        vk_depth_formats.push_back(VK_FORMAT_D32_SFLOAT_S8_UINT);
     }
 
     // We always push the D24 and D16 formats regardless
@@ -263,21 +300,32 @@ void Graphics::VulkanProvider::determine_present_info() {
     vk_depth_formats.push_back(VK_FORMAT_D16_UNORM_S8_UINT);
 
     // Try to guess a fitting present mode
+    // FIFO blocks on the display, the others let us render as fast as we can
+    // Every surface supports FIFO, so it's the last resort either way
     std::vector<VkPresentModeKHR> vk_present_modes;
 
-    if (vsync) {
-        vk_present_modes.push_back(VK_PRESENT_MODE_FIFO_KHR);
-        vk_present_modes.push_back(VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+    if (!vsync) {
+        vk_present_modes.push_back(VK_PRESENT_MODE_MAILBOX_KHR);
+        vk_present_modes.push_back(VK_PRESENT_MODE_IMMEDIATE_KHR);
     }
 
-    // We always want mailbox or immediate mode even if we request vsync
-    vk_present_modes.push_back(VK_PRESENT_MODE_MAILBOX_KHR);
-    vk_present_modes.push_back(VK_PRESENT_MODE_IMMEDIATE_KHR);
+    vk_present_modes.push_back(VK_PRESENT_MODE_FIFO_KHR);
 
     // Then try to find them
-    VkFormat vk_color_format = find_supported_surface_format(vk_formats);
     VkFormat vk_depth_format = find_supported_format(vk_depth_formats, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-    VkPresentModeKHR vk_present_mode = find_supported_present_mode(vk_present_modes);
+    VkFormat vk_color_format;
+    VkPresentModeKHR vk_present_mode;
+
+    // Without a surface there is nothing to match, any format we can render to will do
+    if (headless) {
+        vk_formats.push_back(VK_FORMAT_R8G8B8A8_UNORM);
+
+        vk_color_format = find_supported_format(vk_formats, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+        vk_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    } else {
+        vk_color_format = find_supported_surface_format(vk_formats);
+        vk_present_mode = find_supported_present_mode(vk_present_modes);
+    }
 
     present_info.vk_color_format = vk_color_format;
     present_info.vk_depth_format = vk_depth_format;
@@ -286,7 +334,6 @@ void Graphics::VulkanProvider::determine_present_info() {
 }
 
 void Graphics::VulkanProvider::create_instance(Sapphire::Engine *p_engine) {
-    // TODO: Allow creation without a window
     VkInstanceCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 
@@ -319,16 +366,30 @@ void Graphics::VulkanProvider::create_instance(Sapphire::Engine *p_engine) {
     std::vector<const char*> enabled_extensions;
     std::vector<const char*> enabled_layers;
 
-    uint32_t extension_count;
+    // Headless instances don't need the surface extensions, so they also work on machines without a display
+    if (!headless) {
+        uint32_t extension_count;
 
-    SDL_Vulkan_GetInstanceExtensions(p_engine->main_window->get_handle(), &extension_count, nullptr);
-    enabled_extensions.resize(extension_count);
-    SDL_Vulkan_GetInstanceExtensions(p_engine->main_window->get_handle(), &extension_count, enabled_extensions.data());
+        SDL_Vulkan_GetInstanceExtensions(p_engine->main_window->get_handle(), &extension_count, nullptr);
+        enabled_extensions.resize(extension_count);
+        SDL_Vulkan_GetInstanceExtensions(p_engine->main_window->get_handle(), &extension_count, enabled_extensions.data());
+    }
 
     // TODO: Make this toggleable with config entries
     enabled_layers.emplace_back("VK_LAYER_KHRONOS_validation");
 
-    // TODO: Add our own extensions
+    // Optional extensions, these are only enabled if the loader supports them
+    // Vulkan 1.0 needs properties2 for VK_EXT_memory_budget
+    if (is_instance_extension_supported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+        enabled_extensions.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        ext_properties2_enabled = true;
+    }
+
+    // Vulkan 1.0 needs device groups for VK_KHR_buffer_device_address
+    if (is_instance_extension_supported(VK_KHR_DEVICE_GROUP_CREATION_EXTENSION_NAME)) {
+        enabled_extensions.emplace_back(VK_KHR_DEVICE_GROUP_CREATION_EXTENSION_NAME);
+        ext_device_group_creation_enabled = true;
+    }
 
     if (!validate_instance_extensions(enabled_extensions, p_engine)) {
         throw std::runtime_error("Failed to validate instance extensions. Please check the log above for more info!");
@@ -351,7 +412,7 @@ void Graphics::VulkanProvider::create_instance(Sapphire::Engine *p_engine) {
 }
 
 void Graphics::VulkanProvider::find_gpu(Engine *p_engine, VkSurfaceKHR vk_surface) {
-    if (vk_surface == nullptr) {
+    if (vk_surface == nullptr && !headless) {
         throw std::runtime_error("vk_surface is nullptr!");
     }
 
@@ -387,7 +448,6 @@ void Graphics::VulkanProvider::find_gpu(Engine *p_engine, VkSurfaceKHR vk_surfac
             LOG_GRAPHICS("\tVENDOR: " << std::hex << "0x" << properties.vendorID << std::dec);
         }
 
-        uint32_t queue_index = 0;
         std::vector<Queue> found_queues;
 
         std::vector<QueueType> needed_queues = {
@@ -396,66 +456,79 @@ void Graphics::VulkanProvider::find_gpu(Engine *p_engine, VkSurfaceKHR vk_surfac
             QueueType::Transfer
         };
 
-        // TODO: Better queue exclusivity?
-        for (VkQueueFamilyProperties queue_family: queue_families) {
-            for (QueueType type : needed_queues) {
-                // Ensure we haven't already found a suitable queue
-                bool already_found = false;
-
-                for (Queue& queue : found_queues) {
-                    if (queue.type == type) {
-                        already_found = true;
-                    }
-                }
-
-                if (already_found) {
-                    continue;
-                }
-
-                Queue queue {};
-                queue.type = type;
-                queue.family = queue_index;
-
-                bool unique = false;
-
-                switch (type) {
-                    case QueueType::Graphics: {
-                        if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                            found_queues.push_back(queue);
-                            unique = true;
-                        }
-
-                        break;
-                    }
-
-                    case QueueType::Transfer: {
-                        if (queue_family.queueFlags & VK_QUEUE_TRANSFER_BIT) {
-                            found_queues.push_back(queue);
-                            unique = true;
-                        }
-
-                        break;
-                    }
-
-                    case QueueType::Present: {
-                        VkBool32 surface_support = false;
-                        vkGetPhysicalDeviceSurfaceSupportKHR(gpu, queue_index, vk_surface, &surface_support);
-
-                        if (surface_support) {
-                            found_queues.push_back(queue);
-                            unique = true;
-                        }
-
-                        break;
-                    }
-                }
-
-                if (unique) {
+        const uint32_t NO_FAMILY = -1;
+
+        uint32_t graphics_family = NO_FAMILY;
+        uint32_t present_family = NO_FAMILY;
+        uint32_t transfer_family = NO_FAMILY;
+
+        // Graphics goes to the first family that supports it
+        // Transfer prefers a dedicated (transfer only) family, those are usually DMA engines that run beside rendering
+        for (uint32_t queue_index = 0; queue_index < queue_families.size(); queue_index++) {
+            VkQueueFlags flags = queue_families[queue_index].queueFlags;
+
+            if (graphics_family == NO_FAMILY && (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                graphics_family = queue_index;
+            }
+
+            bool dedicated_transfer = (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+
+            if (transfer_family == NO_FAMILY && dedicated_transfer) {
+                transfer_family = queue_index;
+            }
+        }
+
+        // Graphics families always support transfer commands, even if they don't advertise it
+        if (transfer_family == NO_FAMILY) {
+            transfer_family = graphics_family;
+        }
+
+        // Present prefers the graphics family so the swapchain images never change owners
+        // Headless there is nothing to present to, so the present queue is just the graphics queue
+        VkBool32 surface_support = false;
+
+        if (headless) {
+            present_family = graphics_family;
+        } else if (graphics_family != NO_FAMILY) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(gpu, graphics_family, vk_surface, &surface_support);
+
+            if (surface_support) {
+                present_family = graphics_family;
+            }
+        }
+
+        for (uint32_t queue_index = 0; queue_index < queue_families.size() && present_family == NO_FAMILY; queue_index++) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(gpu, queue_index, vk_surface, &surface_support);
+
+            if (surface_support) {
+                present_family = queue_index;
+            }
+        }
+
+        for (QueueType type : needed_queues) {
+            Queue queue {};
+            queue.type = type;
+
+            switch (type) {
+                case QueueType::Graphics:
+                    queue.family = graphics_family;
+                    break;
+
+                case QueueType::Present:
+                    queue.family = present_family;
+                    break;
+
+                case QueueType::Transfer:
+                    queue.family = transfer_family;
+                    break;
+
+                default:
                     break;
-                }
             }
 
-            queue_index++;
+            if (queue.family != NO_FAMILY) {
+                found_queues.push_back(queue);
+            }
         }
 
         // TODO: Optional required features
@@ -518,22 +591,46 @@ void Graphics::VulkanProvider::create_device(Sapphire::Engine *p_engine) {
     std::vector<uint32_t> device_queues;
     std::vector<VkDeviceQueueCreateInfo> device_queue_infos;
 
-    float queue_priority = 1;
+    float queue_priorities[] = {1, 1};
 
     std::vector<Queue*> gpu_queues {
-        &queue_present,
         &queue_graphics,
+        &queue_present,
         &queue_transfer
     };
 
-    for (const Queue* queue : gpu_queues) {
+    uint32_t family_count;
+    std::vector<VkQueueFamilyProperties> queue_families;
+
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_gpu, &family_count, nullptr);
+    queue_families.resize(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(vk_gpu, &family_count, queue_families.data());
+
+    for (Queue* queue : gpu_queues) {
+        // Vulkan forbids requesting the same family twice, queues sharing a family share the VkQueue
+        auto iter = std::find(device_queues.begin(), device_queues.end(), queue->family);
+
+        if (iter != device_queues.end()) {
+            VkDeviceQueueCreateInfo &queue_info = device_queue_infos[std::distance(device_queues.begin(), iter)];
+
+            // Unless the present thread can have a spare queue of the graphics family, then presents never wait on submits
+            bool spare_queue = queue_families[queue->family].queueCount > queue_info.queueCount;
+
+            if (queue == &queue_present && use_present_thread && spare_queue && queue_info.queueCount == 1) {
+                queue->index = queue_info.queueCount;
+                queue_info.queueCount += 1;
+            }
+
+            continue;
+        }
+
         device_queues.push_back(queue->family);
 
         VkDeviceQueueCreateInfo queue_info {};
         queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queue_info.queueFamilyIndex = queue->family;
         queue_info.queueCount = 1;
-        queue_info.pQueuePriorities = &queue_priority;
+        queue_info.pQueuePriorities = queue_priorities;
 
         device_queue_infos.push_back(queue_info);
     }
@@ -548,13 +645,114 @@ void Graphics::VulkanProvider::create_device(Sapphire::Engine *p_engine) {
     device_create_info.pEnabledFeatures = &vk_gpu_features;
 
     // Extensions
-    std::vector<const char*> enabled_extensions {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::vector<const char*> enabled_extensions;
+
+    if (!headless) {
+        enabled_extensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
-    // TODO: Optional extensions
     if (!validate_device_extensions(enabled_extensions, p_engine)) {
         throw std::runtime_error("This system doesn't support the required device extensions!");
     }
 
+    // Optional extensions
+    // Without the memory budget extension VMA estimates the budget from the heap sizes
+    if (ext_properties2_enabled && is_device_extension_supported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        enabled_extensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        ext_memory_budget_enabled = true;
+    }
+
+    // Feature structs of optional extensions are chained onto the create info
+    // Each extension's features are only turned on when every one we need is there, otherwise the provider goes without it
+    void *p_feature_chain = nullptr;
+
+    PFN_vkGetPhysicalDeviceFeatures2KHR vkGetPhysicalDeviceFeatures2KHR = nullptr;
+
+    if (ext_properties2_enabled) {
+        vkGetPhysicalDeviceFeatures2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(vk_instance, "vkGetPhysicalDeviceFeatures2KHR")
+        );
+    }
+
+    // Bindless needs runtime sized, partially bound arrays that can be written while bound
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features {};
+    indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    if (vkGetPhysicalDeviceFeatures2KHR != nullptr
+        && is_device_extension_supported(VK_KHR_MAINTENANCE3_EXTENSION_NAME)
+        && is_device_extension_supported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported_features {};
+        supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2KHR features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features.pNext = &supported_features;
+
+        vkGetPhysicalDeviceFeatures2KHR(vk_gpu, &features);
+
+        bool supported = supported_features.runtimeDescriptorArray
+            && supported_features.descriptorBindingPartiallyBound
+            && supported_features.descriptorBindingStorageBufferUpdateAfterBind
+            && supported_features.descriptorBindingSampledImageUpdateAfterBind
+            && supported_features.shaderStorageBufferArrayNonUniformIndexing
+            && supported_features.shaderSampledImageArrayNonUniformIndexing;
+
+        if (supported) {
+            indexing_features.runtimeDescriptorArray = VK_TRUE;
+            indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+            indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexing_features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+            indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+            indexing_features.pNext = p_feature_chain;
+            p_feature_chain = &indexing_features;
+
+            enabled_extensions.emplace_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            enabled_extensions.emplace_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+            ext_descriptor_indexing_enabled = true;
+        }
+    }
+
+    // Lets shaders read pool memory through raw pointers, see MemoryBlock::get_vk_address()
+    VkPhysicalDeviceBufferDeviceAddressFeaturesKHR address_features {};
+    address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR;
+
+    if (vkGetPhysicalDeviceFeatures2KHR != nullptr
+        && ext_device_group_creation_enabled
+        && is_device_extension_supported(VK_KHR_DEVICE_GROUP_EXTENSION_NAME)
+        && is_device_extension_supported(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
+        VkPhysicalDeviceBufferDeviceAddressFeaturesKHR supported_features {};
+        supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR;
+
+        VkPhysicalDeviceFeatures2KHR features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features.pNext = &supported_features;
+
+        vkGetPhysicalDeviceFeatures2KHR(vk_gpu, &features);
+
+        if (supported_features.bufferDeviceAddress) {
+            address_features.bufferDeviceAddress = VK_TRUE;
+
+            address_features.pNext = p_feature_chain;
+            p_feature_chain = &address_features;
+
+            enabled_extensions.emplace_back(VK_KHR_DEVICE_GROUP_EXTENSION_NAME);
+            enabled_extensions.emplace_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+
+            ext_buffer_device_address_enabled = true;
+        }
+    }
+
+    device_create_info.pNext = p_feature_chain;
+
+    if (p_engine->has_verbosity(Engine::VerbosityFlags::Graphics)) {
+        LOG_GRAPHICS("VK_EXT_memory_budget: " << (ext_memory_budget_enabled ? "enabled" : "unavailable"));
+        LOG_GRAPHICS("VK_EXT_descriptor_indexing: " << (ext_descriptor_indexing_enabled ? "enabled" : "unavailable"));
+        LOG_GRAPHICS("VK_KHR_buffer_device_address: " << (ext_buffer_device_address_enabled ? "enabled" : "unavailable"));
+    }
+
     device_create_info.ppEnabledExtensionNames = enabled_extensions.data();
     device_create_info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
 
@@ -567,9 +765,29 @@ void Graphics::VulkanProvider::create_device(Sapphire::Engine *p_engine) {
         throw std::runtime_error("vkCreateDevice failed! Please check the log above for more info!");
     }
 
+    if (ext_buffer_device_address_enabled) {
+        pfn_get_buffer_device_address = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(
+            vkGetDeviceProcAddr(vk_device, "vkGetBufferDeviceAddressKHR")
+        );
+    }
+
     // Setup the queue references
+    uint32_t mutex_count = 0;
+
     for (Queue* queue : gpu_queues) {
-        vkGetDeviceQueue(vk_device, queue->family, 0, &queue->vk_queue);
+        vkGetDeviceQueue(vk_device, queue->family, queue->index, &queue->vk_queue);
+
+        for (const Queue* other : gpu_queues) {
+            if (other == queue) {
+                queue->p_mutex = &queue_mutexes[mutex_count++];
+                break;
+            }
+
+            if (other->vk_queue == queue->vk_queue) {
+                queue->p_mutex = other->p_mutex;
+                break;
+            }
+        }
 
         uint32_t flags;
         switch (queue->type) {
@@ -577,8 +795,9 @@ void Graphics::VulkanProvider::create_device(Sapphire::Engine *p_engine) {
                 flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
                 break;
 
+            // Upload command buffers are short-lived but recycled between batches
             case QueueType::Transfer:
-                flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
                 break;
         }
 
@@ -603,6 +822,15 @@ void Graphics::VulkanProvider::create_vma_allocator(Sapphire::Engine *p_engine)
     allocatorInfo.device = vk_device;
     allocatorInfo.instance = vk_instance;
 
+    if (ext_memory_budget_enabled) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
+
+    // VMA has to allocate the memory of addressable buffers with the device address flag
+    if (ext_buffer_device_address_enabled) {
+        allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+    }
+
     VkResult result = vmaCreateAllocator(&allocatorInfo, &vma_allocator);
 
     if (result != VK_SUCCESS) {
@@ -610,76 +838,204 @@ void Graphics::VulkanProvider::create_vma_allocator(Sapphire::Engine *p_engine)
         throw std::runtime_error("vkCreateCommandPool failed! Please check the log above for more info!");
     }
 
-    // We also pre-allocate our mesh, texture, and buffer block pools
-    // They're usually clusters of a certain size
+    // We also set up our mesh, texture, and buffer block pools
+    // Nothing is allocated until the first upload, chunks then double in size up to the max
+    // Pools are also a transfer source so defragmentation can move blocks between chunks
+    // Every pool is a storage buffer too, so blocks can be reached through the bindless table
     // TODO: Allow the user to change the VRAM usage target?
     // TODO: Change generic to user?
     // TODO: Unify uniform and mesh blocks as per? https://developer.nvidia.com/vulkan-memory-management
-    mp_mesh = new MemoryPool(
-        this,
-        SizeTools::mib_to_bytes(MP_MESH_STRIDE_MB),
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        0
+    // With buffer device addresses every block of every chunk can be reached through a pointer, which gets us most of the way there
+    // When the CPU can write device local memory directly, uploads skip staging entirely
+    // ReBAR keeps textures staged, they're the bulk of VRAM and the mappable heap is shared with everything else
+    bool direct_mesh = memory_model != MemoryModel::Discrete;
+    bool direct_texture = memory_model == MemoryModel::UMA;
+    bool direct_buffer = memory_model != MemoryModel::Discrete;
+
+    VkBufferUsageFlags address_usage = ext_buffer_device_address_enabled ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR : 0;
+
+    mp_mesh = create_memory_pool(
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | address_usage,
+        direct_mesh
     );
 
-    mp_texture = new MemoryPool(
-        this,
-        SizeTools::mib_to_bytes(MP_TEXTURE_STRIDE_MB),
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        0
+    mp_texture = create_memory_pool(
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | address_usage,
+        direct_texture
     );
 
-    mp_buffer = new MemoryPool(
-        this,
-        SizeTools::mib_to_bytes(MP_BUFFER_STRIDE_MB),
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        0
+    mp_buffer = create_memory_pool(
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | address_usage,
+        direct_buffer
     );
 
     smp_staging = new StagingMemoryPool(
         this,
-        SizeTools::mib_to_bytes(SMP_STAGING_STRIDE_MB),
+        SizeTools::mib_to_bytes(SMP_STAGING_RING_MB),
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
     );
+
+    smp_staging->set_upload_budget(upload_budget);
+}
+
+Graphics::MemoryPool *Graphics::VulkanProvider::create_memory_pool(VkBufferUsageFlags usage, bool direct_write) {
+    if (direct_write) {
+        return new MappedMemoryPool(
+            this,
+            SizeTools::mib_to_bytes(MP_MIN_CHUNK_MB),
+            SizeTools::mib_to_bytes(MP_MAX_CHUNK_MB),
+            usage,
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+    }
+
+    return new MemoryPool(
+        this,
+        SizeTools::mib_to_bytes(MP_MIN_CHUNK_MB),
+        SizeTools::mib_to_bytes(MP_MAX_CHUNK_MB),
+        usage,
+        0
+    );
+}
+
+void Graphics::VulkanProvider::determine_memory_model(Engine *p_engine) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vk_gpu, &properties);
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(vk_gpu, &memory_properties);
+
+    // Coherent memory is required so direct writes never need to be flushed
+    const VkMemoryPropertyFlags mappable_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkDeviceSize mappable_heap_size = 0;
+
+    for (uint32_t t = 0; t < memory_properties.memoryTypeCount; t++) {
+        const VkMemoryType& memory_type = memory_properties.memoryTypes[t];
+
+        if ((memory_type.propertyFlags & mappable_flags) == mappable_flags) {
+            mappable_heap_size = std::max(mappable_heap_size, memory_properties.memoryHeaps[memory_type.heapIndex].size);
+        }
+    }
+
+    bool integrated = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+    if (mappable_heap_size == 0) {
+        memory_model = MemoryModel::Discrete;
+    } else if (integrated) {
+        memory_model = MemoryModel::UMA;
+    } else if (mappable_heap_size > SizeTools::mib_to_bytes(REBAR_MIN_HEAP_MB)) {
+        memory_model = MemoryModel::ReBAR;
+    } else {
+        // The classic 256 MiB BAR window is too small to hold our pools
+        memory_model = MemoryModel::Discrete;
+    }
+
+    if (p_engine->has_verbosity(Engine::VerbosityFlags::Graphics)) {
+        const char* model_names[] = {"Discrete", "ReBAR", "UMA"};
+        LOG_GRAPHICS("Memory model: " << model_names[static_cast<int>(memory_model)]);
+    }
 }
 
 // TODO: Will these ever need to be increased?
-void Graphics::VulkanProvider::create_vk_descriptor_pool() {
-    VkDescriptorPoolSize pool_sizes[] =
-            {
-                    {VK_DESCRIPTOR_TYPE_SAMPLER, 1000},
-                    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000},
-                    {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000},
-                    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000},
-                    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000},
-                    {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000}
-            };
-
-    VkDescriptorPoolCreateInfo create_info {};
-    create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    create_info.poolSizeCount = 11;
-    create_info.pPoolSizes = pool_sizes;
-    create_info.maxSets = 1000;
-    create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-    VkResult result = vkCreateDescriptorPool(vk_device, &create_info, nullptr, &vk_descriptor_pool);
+void Graphics::VulkanProvider::create_resource_tables() {
+    rt_memory_blocks = new ResourceTable<MemoryBlock>();
+    rt_mesh_buffers = new ResourceTable<MeshBuffer>();
+    rt_shaders = new ResourceTable<Shader>();
+    rt_shader_modules = new ResourceTable<ShaderModule>();
+}
+
+void Graphics::VulkanProvider::create_descriptor_allocators() {
+    dlc_layouts = new DescriptorLayoutCache(vk_device);
+    dsc_sets = new DescriptorSetCache(this);
+
+    // Pools start small and double as they fill, a steady frame settles on a handful of them
+    for (FrameData& frame : frames) {
+        frame.da_transient = new DescriptorAllocator(vk_device, 128);
+    }
+}
+
+void Graphics::VulkanProvider::create_uniform_ring() {
+    ur_constants = new UniformRing(this, uniform_ring_size, frames_in_flight);
+}
+
+void Graphics::VulkanProvider::create_bindless_table() {
+    if (!ext_descriptor_indexing_enabled) {
+        return;
+    }
+
+    bt_bindless = new BindlessTable(this, BINDLESS_MAX_BUFFERS, BINDLESS_MAX_IMAGES, BINDLESS_MAX_SAMPLERS);
+}
+
+void Graphics::VulkanProvider::create_pipeline_layout() {
+    // Every constants set index uses the same layout, see UniformRing
+    std::vector<VkDescriptorSetLayout> vk_set_layouts(UniformRing::SetCount, ur_constants->get_vk_set_layout());
+
+    if (bt_bindless != nullptr) {
+        vk_set_layouts.push_back(bt_bindless->get_vk_set_layout());
+    }
+
+    VkPushConstantRange push_constant_range {};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = PUSH_CONSTANT_SIZE;
+
+    VkPipelineLayoutCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    create_info.setLayoutCount = static_cast<uint32_t>(vk_set_layouts.size());
+    create_info.pSetLayouts = vk_set_layouts.data();
+    create_info.pushConstantRangeCount = 1;
+    create_info.pPushConstantRanges = &push_constant_range;
+
+    VkResult result = vkCreatePipelineLayout(vk_device, &create_info, nullptr, &vk_pipeline_layout);
 
     if (result != VK_SUCCESS) {
-        LOG_GRAPHICS("Error: vkCreateDescriptorPool failed with error code (" << result << ")");
-        throw std::runtime_error("vkCreateDescriptorPool failed! Please check the log above for more info!");
+        LOG_GRAPHICS("Error: vkCreatePipelineLayout failed with error code (" << result << ")");
+        throw std::runtime_error("vkCreatePipelineLayout failed! Please check the log above for more info!");
     }
 }
 
 void Graphics::VulkanProvider::create_render_passes() {
-    RenderPassBuilder builder;
+    // Pipelines are built against the image pass and used in both, so the passes must be compatible
+    // They may only differ in layouts and load / store ops, so both get the same dependencies
+    //
+    // Copies out of the previous use of an image must finish before it's cleared
+    // The window's acquire semaphore is waited on at COLOR_ATTACHMENT_OUTPUT, which this also chains onto
+    DependencyInfo begin_dependency{};
+    begin_dependency.dst_subpass = 0;
+    begin_dependency.src_stage_flags = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    begin_dependency.dst_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    begin_dependency.dst_access_flags = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    begin_dependency.dependency_flags = 0;
+
+    DependencyInfo end_dependency{};
+    end_dependency.src_subpass = 0;
+    end_dependency.src_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    end_dependency.dst_stage_flags = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    end_dependency.src_access_flags = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    end_dependency.dst_access_flags = VK_ACCESS_TRANSFER_READ_BIT;
+    end_dependency.dependency_flags = 0;
+
+    // The image pass hands its result over to transfers, so it can be copied out as soon as the frame's fence signals
+    RenderPassBuilder image_builder;
+
+    ColorAttachmentInfo image_color_info{};
+    image_color_info.format = present_info.vk_color_format;
+    image_color_info.final_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_color_info.ref_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    image_builder.push_color_attachment(image_color_info);
+    image_builder.push_subpass_dependency(begin_dependency);
+    image_builder.push_subpass_dependency(end_dependency);
+
+    vk_render_pass_image = image_builder.build(this);
+
+    if (headless) {
+        return;
+    }
 
-    ColorAttachmentInfo color_attachment;
+    RenderPassBuilder builder;
 
     ColorAttachmentInfo color_info{};
     color_info.format = present_info.vk_color_format;
@@ -696,6 +1052,10 @@ void Graphics::VulkanProvider::create_render_passes() {
     builder.push_color_attachment(color_info);
     //window_render_pass_builder.push_depth_attachment(&depth_stencil_info);
 
+    // The end dependency is unused by presents, but it keeps the passes compatible
+    builder.push_subpass_dependency(begin_dependency);
+    builder.push_subpass_dependency(end_dependency);
+
     vk_render_pass_window = builder.build(this);
 }
 
@@ -761,11 +1121,15 @@ void Graphics::VulkanProvider::warm_fallbacks() {
         std::vector<char> fragment_data(sizeof(FALLBACK_FRAG_CONTENTS));
         memcpy(fragment_data.data(), FALLBACK_FRAG_CONTENTS, sizeof(FALLBACK_FRAG_CONTENTS));
 
-        std::shared_ptr<ShaderModule> sm_vertex = std::make_shared<ShaderModule>(this, ShaderModule::ModuleType::Vertex, vertex_data);
-        std::shared_ptr<ShaderModule> sm_fragment = std::make_shared<ShaderModule>(this, ShaderModule::ModuleType::Fragment, fragment_data);
+        ShaderModuleHandle sm_vertex = create_shader_module(ShaderModule::ModuleType::Vertex, vertex_data);
+        ShaderModuleHandle sm_fragment = create_shader_module(ShaderModule::ModuleType::Fragment, fragment_data);
 
         ShaderProperties props{};
-        shader_fallback = std::make_shared<Shader>(this, props, sm_vertex, sm_fragment);
+        shader_fallback = create_shader(props, get_shader_module(sm_vertex), get_shader_module(sm_fragment));
+
+        // The pipeline keeps everything it needs from the modules
+        destroy_shader_module(sm_vertex);
+        destroy_shader_module(sm_fragment);
     }
 }
 
@@ -784,10 +1148,10 @@ VkSemaphore Graphics::VulkanProvider::create_vk_semaphore() {
     return vk_semaphore;
 }
 
-VkFence Graphics::VulkanProvider::create_vk_fence() {
+VkFence Graphics::VulkanProvider::create_vk_fence(bool signaled) {
     VkFenceCreateInfo fence_create_info{};
     fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    fence_create_info.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
 
     VkFence vk_fence;
 
@@ -801,6 +1165,16 @@ VkFence Graphics::VulkanProvider::create_vk_fence() {
     return vk_fence;
 }
 
+void Graphics::VulkanProvider::create_frames() {
+    fa_frame = new FrameArena(frame_arena_size);
+
+    frames.resize(frames_in_flight);
+
+    for (FrameData& frame : frames) {
+        frame.vk_render_fence = create_vk_fence();
+    }
+}
+
 // TODO: Unify render target code
 VkSurfaceKHR Graphics::VulkanProvider::create_vk_surface(Sapphire::Window *p_window) {
     if (p_window == nullptr) {
@@ -832,7 +1206,13 @@ void Graphics::VulkanProvider::setup_window_render_target(WindowRenderTarget *p_
         throw std::runtime_error("p_target was nullptr!");
     }
 
+    // The old swapchain is about to be retired, nothing else may be using it
+    if (pt_present != nullptr) {
+        pt_present->await_pending(0);
+    }
+
     VkSurfaceKHR vk_surface = p_target->get_vk_surface();
+    WindowRenderTargetData old_rt_data = p_target->get_rt_data();
     WindowRenderTargetData rt_data;
 
     // Refreshes the extent and view data
@@ -860,8 +1240,19 @@ void Graphics::VulkanProvider::setup_window_render_target(WindowRenderTarget *p_
         rt_data.vk_extent = actual_extent;
     }
 
+    // Minimized windows have an empty surface, the old swapchain is kept until there is something to draw to
+    if (rt_data.vk_extent.width == 0 || rt_data.vk_extent.height == 0) {
+        return;
+    }
+
     // Swapchain creation
-    uint32_t image_count = rt_data.vk_capabilities.minImageCount + 1;
+    uint32_t image_count = swapchain_images;
+
+    if (image_count == 0) {
+        image_count = rt_data.vk_capabilities.minImageCount + 1;
+    }
+
+    image_count = std::max(image_count, rt_data.vk_capabilities.minImageCount);
 
     std::vector<uint32_t> device_queues {
         queue_graphics.family,
@@ -889,7 +1280,8 @@ void Graphics::VulkanProvider::setup_window_render_target(WindowRenderTarget *p_
     swapchain_create_info.presentMode = present_info.vk_present_mode;
     swapchain_create_info.clipped = VK_TRUE;
 
-    swapchain_create_info.oldSwapchain = rt_data.vk_swapchain;
+    // Retiring the old swapchain lets the driver hand its resources over, its images that are still queued are presented as usual
+    swapchain_create_info.oldSwapchain = old_rt_data.vk_swapchain;
 
     if (queue_graphics.family != queue_present.family) {
         swapchain_create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
@@ -979,9 +1371,98 @@ void Graphics::VulkanProvider::setup_window_render_target(WindowRenderTarget *p_
         }
     }
 
+    // The old swapchain may still be in use by frames in flight, so it's released through the frame's queue rather than waited on
+    old_rt_data.release(this);
+    p_target->set_rt_data(rt_data);
+}
+
+void Graphics::VulkanProvider::setup_image_render_target(ImageRenderTarget *p_target, VkExtent2D vk_extent) {
+    if (p_target == nullptr) {
+        throw std::runtime_error("p_target was nullptr!");
+    }
+
+    if (vk_extent.width == 0 || vk_extent.height == 0) {
+        throw std::runtime_error("vk_extent must not be empty!");
+    }
+
+    ImageRenderTargetData rt_data;
+    rt_data.vk_extent = vk_extent;
+    rt_data.images.resize(frames_in_flight);
+
+    for (ImageRenderTargetData::Image& image: rt_data.images) {
+        VkImageCreateInfo image_create_info{};
+        image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+
+        image_create_info.imageType = VK_IMAGE_TYPE_2D;
+        image_create_info.format = present_info.vk_color_format;
+        image_create_info.extent.width = vk_extent.width;
+        image_create_info.extent.height = vk_extent.height;
+        image_create_info.extent.depth = 1;
+        image_create_info.mipLevels = 1;
+        image_create_info.arrayLayers = 1;
+        image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Render targets are large and long lived, they get their own memory rather than a pool chunk
+        VmaAllocationCreateInfo alloc_create_info{};
+        alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        alloc_create_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+        VkResult result = vmaCreateImage(vma_allocator, &image_create_info, &alloc_create_info, &image.vk_image, &image.vma_allocation, nullptr);
+
+        if (result != VK_SUCCESS) {
+            LOG_GRAPHICS("vmaCreateImage failed with error code (" << result << ")");
+            throw std::runtime_error("vmaCreateImage failed! Please check the log above for more info!");
+        }
+
+        VkImageViewCreateInfo view_create_info{};
+        view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+
+        view_create_info.image = image.vk_image;
+        view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_create_info.format = present_info.vk_color_format;
+
+        view_create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        view_create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+        view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_create_info.subresourceRange.baseMipLevel = 0;
+        view_create_info.subresourceRange.levelCount = 1;
+        view_create_info.subresourceRange.baseArrayLayer = 0;
+        view_create_info.subresourceRange.layerCount = 1;
+
+        result = vkCreateImageView(vk_device, &view_create_info, nullptr, &image.vk_image_view);
+
+        if (result != VK_SUCCESS) {
+            LOG_GRAPHICS("vkCreateImageView failed with error code (" << result << ")");
+            throw std::runtime_error("vkCreateImageView failed! Please check the log above for more info!");
+        }
+
+        VkFramebufferCreateInfo framebuffer_create_info{};
+        framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_create_info.renderPass = vk_render_pass_image;
+        framebuffer_create_info.attachmentCount = 1;
+        framebuffer_create_info.pAttachments = &image.vk_image_view;
+        framebuffer_create_info.width = vk_extent.width;
+        framebuffer_create_info.height = vk_extent.height;
+        framebuffer_create_info.layers = 1;
+
+        result = vkCreateFramebuffer(vk_device, &framebuffer_create_info, nullptr, &image.vk_framebuffer);
+
+        if (result != VK_SUCCESS) {
+            LOG_GRAPHICS("vkCreateFramebuffer failed with error code (" << result << ")");
+            throw std::runtime_error("vkCreateFramebuffer failed! Please check the log above for more info!");
+        }
+    }
+
     // Clear the old data before setting it
     p_target->get_rt_data().release(this);
-    p_target->set_rt_data(rt_data);
+    p_target->set_rt_data(std::move(rt_data));
 }
 
 VkCommandBuffer Graphics::VulkanProvider::allocate_command_buffer(QueueType queue_type) {
@@ -1011,6 +1492,7 @@ void Graphics::VulkanProvider::free_command_buffer(QueueType queue_type, VkComma
 }
 
 void Graphics::VulkanProvider::reset_render_fence() {
+    VkFence vk_render_fence = get_render_fence();
     VkResult result = vkResetFences(vk_device, 1, &vk_render_fence);
 
     if (result != VK_SUCCESS) {
@@ -1019,38 +1501,135 @@ void Graphics::VulkanProvider::reset_render_fence() {
     }
 }
 
-void Graphics::VulkanProvider::initialize(Sapphire::Engine *p_engine) {
-    if (p_engine == nullptr) {
-        throw std::runtime_error("p_engine was nullptr!");
+void Graphics::VulkanProvider::set_frames_in_flight(uint32_t count) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("Frames in flight can't be changed after the provider was initialized!");
     }
 
-    create_instance(p_engine);
-
-    // We initialize an incomplete render target!
-    // This is necessary for fetching the supported formats of the host OS
-    // If said host OS is Windows, then this isn't optional! Thank you Microsoft :|
-    VkSurfaceKHR vk_surface = nullptr;
-    if (!SDL_Vulkan_CreateSurface(p_engine->main_window->get_handle(), vk_instance, &vk_surface)) {
-        throw std::runtime_error("SDL_Vulkan_CreateSurface failed!");
+    if (count == 0) {
+        throw std::runtime_error("At least one frame in flight is required!");
     }
 
-    // Then find a GPU for presentation
-    find_gpu(p_engine, vk_surface);
-    create_device(p_engine);
+    frames_in_flight = count;
+}
 
-    // Then VMA
-    create_vma_allocator(p_engine);
+void Graphics::VulkanProvider::set_defrag_budget(size_t bytes) {
+    defrag_budget = bytes;
+}
+
+void Graphics::VulkanProvider::set_upload_budget(size_t bytes) {
+    upload_budget = bytes;
+
+    if (smp_staging != nullptr) {
+        smp_staging->set_upload_budget(upload_budget);
+    }
+}
 
-    // Then our necessary sync objects
-    vk_image_available_semaphore = create_vk_semaphore();
-    vk_render_finished_semaphore = create_vk_semaphore();
-    vk_render_fence = create_vk_fence();
+void Graphics::VulkanProvider::set_uniform_ring_size(size_t bytes) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("The uniform ring size can't be changed after the provider was initialized!");
+    }
+
+    uniform_ring_size = bytes;
+}
+
+void Graphics::VulkanProvider::set_frame_arena_size(size_t bytes) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("The frame arena size can't be changed after the provider was initialized!");
+    }
+
+    frame_arena_size = bytes;
+}
+
+void Graphics::VulkanProvider::set_max_queued_frames(uint32_t count) {
+    max_queued_frames = count;
+}
+
+void Graphics::VulkanProvider::set_vsync(bool vsync) {
+    this->vsync = vsync;
+
+    // sRGB and D32 are locked after initialization, so only the present mode can change here
+    if (vk_device != nullptr) {
+        determine_present_info();
+    }
+}
+
+void Graphics::VulkanProvider::set_swapchain_images(uint32_t count) {
+    swapchain_images = count;
+}
+
+void Graphics::VulkanProvider::set_srgb(bool srgb) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("sRGB can't be changed after the provider was initialized!");
+    }
+
+    this->srgb = srgb;
+}
+
+void Graphics::VulkanProvider::set_d32(bool d32) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("D32 can't be changed after the provider was initialized!");
+    }
+
+    this->d32 = d32;
+}
+
+void Graphics::VulkanProvider::set_present_thread(bool enabled) {
+    if (vk_device != nullptr) {
+        throw std::runtime_error("The present thread can't be toggled after the provider was initialized!");
+    }
+
+    use_present_thread = enabled;
+}
+
+void Graphics::VulkanProvider::set_pool_idle_frames(uint32_t count) {
+    // Chunks must stay alive at least until the frames that last used them have finished
+    pool_idle_frames = std::max(count, frames_in_flight);
+}
+
+void Graphics::VulkanProvider::initialize(Sapphire::Engine *p_engine) {
+    if (p_engine == nullptr) {
+        throw std::runtime_error("p_engine was nullptr!");
+    }
+
+    // Without a window we render offscreen only, e.g. on machines without a display
+    headless = p_engine->main_window == nullptr;
+
+    create_instance(p_engine);
+
+    // We initialize an incomplete render target!
+    // This is necessary for fetching the supported formats of the host OS
+    // If said host OS is Windows, then this isn't optional! Thank you Microsoft :|
+    VkSurfaceKHR vk_surface = nullptr;
+    if (!headless && !SDL_Vulkan_CreateSurface(p_engine->main_window->get_handle(), vk_instance, &vk_surface)) {
+        throw std::runtime_error("SDL_Vulkan_CreateSurface failed!");
+    }
+
+    // Then find a GPU for presentation
+    find_gpu(p_engine, vk_surface);
+    create_device(p_engine);
+
+    // Then the resource tables, pools register their blocks in them
+    create_resource_tables();
+
+    // Then VMA
+    determine_memory_model(p_engine);
+    create_vma_allocator(p_engine);
+
+    // Then our necessary sync objects (one set per frame in flight)
+    create_frames();
 
     // Then pools
-    create_vk_descriptor_pool();
+    create_descriptor_allocators();
+    create_uniform_ring();
+    create_bindless_table();
+    create_pipeline_layout();
 
     // Then ultimately our swapchain / present formats
-    cache_surface_info(vk_surface);
+    if (!headless) {
+        cache_surface_info(vk_surface);
+    }
+
     determine_present_info();
 
     create_render_passes();
@@ -1058,14 +1637,25 @@ void Graphics::VulkanProvider::initialize(Sapphire::Engine *p_engine) {
 
     warm_fallbacks();
 
+    // Windows present from here on, so the thread has to exist before their targets
+    if (use_present_thread && !headless) {
+        pt_present = new PresentThread(this);
+    }
+
     // Finally, initialize the render target of the main window by hand
-    p_engine->main_window->set_render_target(new Graphics::WindowRenderTarget(this, p_engine->main_window, vk_surface));
+    if (!headless) {
+        p_engine->main_window->set_render_target(new Graphics::WindowRenderTarget(this, p_engine->main_window, vk_surface));
+    }
 }
 
 VkInstance Graphics::VulkanProvider::get_vk_instance() {
     return vk_instance;
 }
 
+VkPhysicalDevice Graphics::VulkanProvider::get_vk_gpu() {
+    return vk_gpu;
+}
+
 VkDevice Graphics::VulkanProvider::get_vk_device() {
     return vk_device;
 }
@@ -1074,22 +1664,30 @@ VmaAllocator Graphics::VulkanProvider::get_vma_allocator() {
     return vma_allocator;
 }
 
-VkSemaphore Graphics::VulkanProvider::get_image_available_semaphore() {
-    return vk_image_available_semaphore;
+VkFence Graphics::VulkanProvider::get_render_fence() {
+    return frames[frame_index].vk_render_fence;
+}
+
+uint32_t Graphics::VulkanProvider::get_frames_in_flight() const {
+    return frames_in_flight;
 }
 
-VkSemaphore Graphics::VulkanProvider::get_render_finished_semaphore() {
-    return vk_render_finished_semaphore;
+uint32_t Graphics::VulkanProvider::get_frame_index() const {
+    return frame_index;
 }
 
-VkFence Graphics::VulkanProvider::get_render_fence() {
-    return vk_render_fence;
+uint64_t Graphics::VulkanProvider::get_frame_number() const {
+    return frame_number;
 }
 
 VkRenderPass Graphics::VulkanProvider::get_render_pass_window() {
     return vk_render_pass_window;
 }
 
+VkRenderPass Graphics::VulkanProvider::get_render_pass_image() {
+    return vk_render_pass_image;
+}
+
 Graphics::VulkanProvider::Queue Graphics::VulkanProvider::get_queue(Graphics::VulkanProvider::QueueType type) {
     switch (type) {
         case QueueType::Transfer:
@@ -1110,26 +1708,338 @@ VkVertexInputBindingDescription Graphics::VulkanProvider::get_vk_vtx_binding() {
     return vk_vtx_binding;
 }
 
-std::vector<VkVertexInputAttributeDescription> Graphics::VulkanProvider::get_vk_vtx_attributes() {
+const std::vector<VkVertexInputAttributeDescription>& Graphics::VulkanProvider::get_vk_vtx_attributes() {
     return vk_vtx_attributes;
 }
 
-std::shared_ptr<Graphics::Shader> Graphics::VulkanProvider::get_shader_fallback() {
+Graphics::ShaderHandle Graphics::VulkanProvider::get_shader_fallback() {
     return shader_fallback;
 }
 
+Graphics::UniformRing *Graphics::VulkanProvider::get_uniform_ring() {
+    return ur_constants;
+}
+
+Graphics::PresentThread *Graphics::VulkanProvider::get_present_thread() {
+    return pt_present;
+}
+
+void Graphics::VulkanProvider::poll_present_thread() {
+    PresentThread::Result result;
+
+    while (pt_present->poll(result)) {
+        for (uint32_t s = 0; s < result.count; s++) {
+            result.p_targets[s]->handle_present_result(result.results[s]);
+        }
+
+        report_present_timing(result.timing);
+    }
+}
+
+void Graphics::VulkanProvider::report_present_timing(const PresentTiming &timing) {
+    last_present_timing = timing;
+}
+
+Graphics::PresentTiming Graphics::VulkanProvider::get_present_timing() const {
+    return last_present_timing;
+}
+
+Graphics::BindlessTable *Graphics::VulkanProvider::get_bindless_table() {
+    return bt_bindless;
+}
+
+VkPipelineLayout Graphics::VulkanProvider::get_vk_pipeline_layout() {
+    return vk_pipeline_layout;
+}
+
+Graphics::DescriptorLayoutCache *Graphics::VulkanProvider::get_descriptor_layout_cache() {
+    return dlc_layouts;
+}
+
+Graphics::DescriptorSetCache *Graphics::VulkanProvider::get_descriptor_set_cache() {
+    return dsc_sets;
+}
+
+VkDescriptorSet Graphics::VulkanProvider::allocate_transient_set(VkDescriptorSetLayout vk_layout) {
+    return frames[frame_index].da_transient->allocate(vk_layout);
+}
+
+FrameArena *Graphics::VulkanProvider::get_frame_arena() {
+    return fa_frame;
+}
+
 void Graphics::VulkanProvider::flush() {
+    // Defragmentation moves ride along with this flush's uploads, sharing the per-frame budget across pools
+    VkDeviceSize defrag_remaining = defrag_budget;
+
+    // A pool may overshoot its share, a single block larger than the budget still moves on its own
+    for (MemoryPool *p_pool : {mp_mesh, mp_texture, mp_buffer}) {
+        if (defrag_remaining == 0) {
+            break;
+        }
+
+        VkDeviceSize moved = p_pool->defragment(smp_staging, defrag_remaining);
+        defrag_remaining = moved >= defrag_remaining ? 0 : defrag_remaining - moved;
+    }
+
     smp_staging->flush(this);
 
-    // Clear out any queued destructions
-    for (const auto& release : deferred_releases) {
+    // Give back any chunks that have sat empty for long enough
+    mp_mesh->collect(frame_number, pool_idle_frames);
+    mp_texture->collect(frame_number, pool_idle_frames);
+    mp_buffer->collect(frame_number, pool_idle_frames);
+
+    check_memory_pressure();
+}
+
+uint32_t Graphics::VulkanProvider::fill_heap_budgets(HeapBudget *p_budgets) {
+    const VkPhysicalDeviceMemoryProperties *p_memory_properties = nullptr;
+    vmaGetMemoryProperties(vma_allocator, &p_memory_properties);
+
+    VmaBudget vma_budgets[VK_MAX_MEMORY_HEAPS] {};
+    vmaGetHeapBudgets(vma_allocator, vma_budgets);
+
+    for (uint32_t h = 0; h < p_memory_properties->memoryHeapCount; h++) {
+        HeapBudget& budget = p_budgets[h];
+        budget.heap_index = h;
+        budget.vk_heap_flags = p_memory_properties->memoryHeaps[h].flags;
+        budget.usage = vma_budgets[h].usage;
+        budget.budget = vma_budgets[h].budget;
+        budget.allocated_bytes = vma_budgets[h].statistics.allocationBytes;
+        budget.block_bytes = vma_budgets[h].statistics.blockBytes;
+    }
+
+    return p_memory_properties->memoryHeapCount;
+}
+
+std::vector<Graphics::VulkanProvider::HeapBudget> Graphics::VulkanProvider::get_heap_budgets() {
+    HeapBudget budgets[VK_MAX_MEMORY_HEAPS] {};
+    uint32_t heap_count = fill_heap_budgets(budgets);
+
+    return std::vector<HeapBudget>(budgets, budgets + heap_count);
+}
+
+void Graphics::VulkanProvider::check_memory_pressure() {
+    if (memory_pressure_callbacks.empty()) {
+        return;
+    }
+
+    // This runs every frame, so the budgets stay on the stack
+    HeapBudget budgets[VK_MAX_MEMORY_HEAPS] {};
+    uint32_t heap_count = fill_heap_budgets(budgets);
+
+    // Callbacks fire every frame the heap stays over the threshold, so managers can evict progressively
+    for (uint32_t h = 0; h < heap_count; h++) {
+        const HeapBudget& budget = budgets[h];
+
+        if (budget.budget == 0) {
+            continue;
+        }
+
+        float pressure = static_cast<float>(budget.usage) / static_cast<float>(budget.budget);
+
+        if (pressure < memory_pressure_threshold) {
+            continue;
+        }
+
+        for (const auto& callback : memory_pressure_callbacks) {
+            callback(this, budget);
+        }
+    }
+}
+
+std::vector<Graphics::MemoryPoolStats> Graphics::VulkanProvider::get_memory_stats() {
+    std::vector<MemoryPoolStats> stats;
+
+    std::pair<const char*, MemoryPool*> pools[] = {
+        {"mesh", mp_mesh},
+        {"texture", mp_texture},
+        {"buffer", mp_buffer},
+        {"staging", smp_staging}
+    };
+
+    for (auto& [name, p_pool] : pools) {
+        MemoryPoolStats pool_stats = p_pool->get_stats();
+        pool_stats.name = name;
+
+        stats.push_back(pool_stats);
+    }
+
+    return stats;
+}
+
+void Graphics::VulkanProvider::dump_memory_report(const std::string &path) {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open the memory report file!");
+    }
+
+    const char* model_names[] = {"Discrete", "ReBAR", "UMA"};
+
+    file << "{\n";
+    file << "  \"frame_number\": " << frame_number << ",\n";
+    file << "  \"memory_model\": \"" << model_names[static_cast<int>(memory_model)] << "\",\n";
+
+    // What the driver thinks we're using
+    std::vector<HeapBudget> budgets = get_heap_budgets();
+
+    file << "  \"heaps\": [";
+
+    for (size_t h = 0; h < budgets.size(); h++) {
+        const HeapBudget& budget = budgets[h];
+
+        file << (h == 0 ? "\n" : ",\n");
+        file << "    {\"index\": " << budget.heap_index
+             << ", \"device_local\": " << ((budget.vk_heap_flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+             << ", \"usage\": " << budget.usage
+             << ", \"budget\": " << budget.budget
+             << ", \"allocated_bytes\": " << budget.allocated_bytes
+             << ", \"block_bytes\": " << budget.block_bytes << "}";
+    }
+
+    file << "\n  ],\n";
+
+    // Everything VMA allocated, pools included
+    VmaTotalStatistics vma_total {};
+    vmaCalculateStatistics(vma_allocator, &vma_total);
+
+    file << "  \"total\": {\"block_count\": " << vma_total.total.statistics.blockCount
+         << ", \"block_bytes\": " << vma_total.total.statistics.blockBytes
+         << ", \"alloc_count\": " << vma_total.total.statistics.allocationCount
+         << ", \"used_bytes\": " << vma_total.total.statistics.allocationBytes
+         << ", \"largest_free_range\": " << (vma_total.total.unusedRangeCount > 0 ? vma_total.total.unusedRangeSizeMax : 0) << "},\n";
+
+    // Our suballocations inside those blocks
+    std::vector<MemoryPoolStats> pool_stats = get_memory_stats();
+    MemoryPool *pools[] = {mp_mesh, mp_texture, mp_buffer, smp_staging};
+
+    file << "  \"pools\": [";
+
+    for (size_t p = 0; p < pool_stats.size(); p++) {
+        const MemoryPoolStats& stats = pool_stats[p];
+
+        file << (p == 0 ? "\n" : ",\n");
+        file << "    {\"name\": \"" << stats.name
+             << "\", \"size\": " << stats.size
+             << ", \"used_bytes\": " << stats.used_bytes
+             << ", \"alloc_count\": " << stats.alloc_count
+             << ", \"largest_free_range\": " << stats.largest_free_range
+             << ", \"fragmentation\": " << stats.fragmentation
+             << ", \"chunks\": [";
+
+        for (size_t c = 0; c < stats.chunks.size(); c++) {
+            const MemoryChunkStats& chunk = stats.chunks[c];
+
+            file << (c == 0 ? "\n" : ",\n");
+            file << "      {\"index\": " << chunk.chunk_index
+                 << ", \"size\": " << chunk.size
+                 << ", \"used_bytes\": " << chunk.used_bytes
+                 << ", \"alloc_count\": " << chunk.alloc_count
+                 << ", \"largest_free_range\": " << chunk.largest_free_range
+                 << ", \"fragmentation\": " << chunk.fragmentation
+                 << ", \"slab_count\": " << chunk.slab_count
+                 << ", \"detailed_map\": " << pools[p]->get_detailed_map(chunk.chunk_index) << "}";
+        }
+
+        file << (stats.chunks.empty() ? "]}" : "\n    ]}");
+    }
+
+    file << "\n  ],\n";
+
+    // VMA's own map of every block and allocation, already JSON
+    char *vma_string = nullptr;
+    vmaBuildStatsString(vma_allocator, &vma_string, VK_TRUE);
+
+    file << "  \"vma\": " << vma_string << "\n";
+    file << "}\n";
+
+    vmaFreeStatsString(vma_allocator, vma_string);
+}
+
+void Graphics::VulkanProvider::add_memory_pressure_callback(const MemoryPressureCallback &callback) {
+    memory_pressure_callbacks.push_back(callback);
+}
+
+void Graphics::VulkanProvider::set_memory_pressure_threshold(float threshold) {
+    memory_pressure_threshold = threshold;
+}
+
+Graphics::VulkanProvider::MemoryModel Graphics::VulkanProvider::get_memory_model() const {
+    return memory_model;
+}
+
+bool Graphics::VulkanProvider::is_headless() const {
+    return headless;
+}
+
+bool Graphics::VulkanProvider::has_memory_budget() const {
+    return ext_memory_budget_enabled;
+}
+
+bool Graphics::VulkanProvider::has_descriptor_indexing() const {
+    return ext_descriptor_indexing_enabled;
+}
+
+bool Graphics::VulkanProvider::has_buffer_device_address() const {
+    return ext_buffer_device_address_enabled;
+}
+
+VkDeviceAddress Graphics::VulkanProvider::get_vk_buffer_address(VkBuffer vk_buffer) {
+    if (pfn_get_buffer_device_address == nullptr) {
+        return 0;
+    }
+
+    VkBufferDeviceAddressInfoKHR address_info {};
+    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+    address_info.buffer = vk_buffer;
+
+    return pfn_get_buffer_device_address(vk_device, &address_info);
+}
+
+void Graphics::VulkanProvider::run_retired_releases() {
+    // Releases may queue more releases, those land in the current frame's queue instead
+    for (ReleaseFunction& release : retired_releases) {
         release(this);
     }
 
-    deferred_releases.clear();
+    retired_releases.clear();
 }
 
 void Graphics::VulkanProvider::begin_frame() {
+    // Everything allocated from the arena last frame is dead by now
+    fa_frame->reset();
+
+    await_queued_frames();
+
+    // Move onto the next slot in the ring, this only blocks if the GPU is still working on the frame that last used it
+    // Releases queued from here on belong to the new frame, so the slot's old queue is taken in the same step
+    {
+        std::lock_guard<std::mutex> lock(release_mutex);
+
+        frame_number++;
+        frame_index = static_cast<uint32_t>(frame_number % frames_in_flight);
+
+        std::swap(retired_releases, frames[frame_index].releases);
+    }
+
+    await_frame();
+
+    if (pt_present != nullptr) {
+        poll_present_thread();
+    }
+
+    // The GPU is done with this slot's constants and transient sets too
+    ur_constants->begin_frame(frame_index);
+    frames[frame_index].da_transient->reset();
+
+    // VMA only refreshes its budget numbers when the frame index changes
+    vmaSetCurrentFrameIndex(vma_allocator, static_cast<uint32_t>(frame_number));
+
+    // Waiting on this slot means the frame that last used it has finished
+    // Anything that frame could have been reading can be destroyed now
+    run_retired_releases();
+
     defer_release = true;
 }
 
@@ -1138,58 +2048,276 @@ void Graphics::VulkanProvider::end_frame() {
 }
 
 void Graphics::VulkanProvider::await_frame() {
-    VulkanProvider::Queue queue = get_queue(VulkanProvider::QueueType::Graphics);
+    if (vk_device == nullptr || frames.empty()) {
+        return;
+    }
+
+    // The fence is reset right before the frame is submitted again
+    // That way a frame that never gets submitted can't deadlock the next wait
+    VkFence vk_render_fence = get_render_fence();
+    VkResult result = vkWaitForFences(vk_device, 1, &vk_render_fence, VK_TRUE, UINT64_MAX);
 
-    if (vk_device != nullptr && vk_render_fence != nullptr) {
-        vkWaitForFences(vk_device, 1, &vk_render_fence, VK_TRUE, UINT64_MAX);
-        reset_render_fence();
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("vkWaitForFences failed with error code (" << result << ")");
+        throw std::runtime_error("vkWaitForFences failed! Please check the log above for more info!");
     }
 }
 
-VkCommandBuffer Graphics::VulkanProvider::begin_upload(QueueType type) {
-    VkCommandBuffer vk_upload_buffer = allocate_command_buffer(type);
+void Graphics::VulkanProvider::await_queued_frames() {
+    if (vk_device == nullptr || frames.empty()) {
+        return;
+    }
+
+    uint32_t queued_frames = max_queued_frames;
+
+    if (queued_frames == 0 || queued_frames > frames_in_flight) {
+        queued_frames = frames_in_flight;
+    }
+
+    // The next frame to be recorded is frame_number + 1, so the frame it waits on is queued_frames before that
+    // That frame's slot hasn't been reused yet, so its fence is still the one that frame signals
+    uint64_t next_frame = frame_number + 1;
+
+    if (next_frame <= queued_frames) {
+        return;
+    }
+
+    VkFence vk_render_fence = frames[(next_frame - queued_frames) % frames_in_flight].vk_render_fence;
+    VkResult result = vkWaitForFences(vk_device, 1, &vk_render_fence, VK_TRUE, UINT64_MAX);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("vkWaitForFences failed with error code (" << result << ")");
+        throw std::runtime_error("vkWaitForFences failed! Please check the log above for more info!");
+    }
+}
+
+void Graphics::VulkanProvider::submit_targets(Graphics::RenderTarget *const *pp_targets, size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    Queue queue = get_queue(QueueType::Graphics);
+
+    FrameVector<VkCommandBuffer> vk_command_buffers(fa_frame);
+    FrameVector<VkSemaphore> vk_wait_semaphores(fa_frame);
+    FrameVector<VkPipelineStageFlags> vk_wait_stages(fa_frame);
+    FrameVector<VkSemaphore> vk_signal_semaphores(fa_frame);
+
+    vk_command_buffers.reserve(count);
+    vk_wait_semaphores.reserve(count);
+    vk_wait_stages.reserve(count);
+    vk_signal_semaphores.reserve(count);
+
+    for (size_t t = 0; t < count; t++) {
+        RenderTarget *p_target = pp_targets[t];
+
+        if (p_target == nullptr) {
+            throw std::runtime_error("p_target is nullptr!");
+        }
+
+        vk_command_buffers.push_back(p_target->get_vk_command_buffer());
+
+        // Offscreen targets have no swapchain image to wait for or hand over
+        VkSemaphore vk_wait_semaphore = p_target->get_vk_wait_semaphore(this);
+        VkSemaphore vk_signal_semaphore = p_target->get_vk_signal_semaphore(this);
+
+        if (vk_wait_semaphore != nullptr) {
+            vk_wait_semaphores.push_back(vk_wait_semaphore);
+            vk_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+
+        if (vk_signal_semaphore != nullptr) {
+            vk_signal_semaphores.push_back(vk_signal_semaphore);
+        }
+    }
+
+    // Waits only hold up the color output stage, so a target can start its vertex work before its window hands over an image
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    submit_info.waitSemaphoreCount = static_cast<uint32_t>(vk_wait_semaphores.size());
+    submit_info.pWaitSemaphores = vk_wait_semaphores.data();
+    submit_info.pWaitDstStageMask = vk_wait_stages.data();
+
+    submit_info.commandBufferCount = static_cast<uint32_t>(vk_command_buffers.size());
+    submit_info.pCommandBuffers = vk_command_buffers.data();
+
+    submit_info.signalSemaphoreCount = static_cast<uint32_t>(vk_signal_semaphores.size());
+    submit_info.pSignalSemaphores = vk_signal_semaphores.data();
+
+    // We only reset the fence once we know we're submitting, the next user of this frame slot waits on it
+    reset_render_fence();
+
+    VkResult result;
+
+    {
+        std::lock_guard<std::mutex> queue_lock(*queue.p_mutex);
+        result = vkQueueSubmit(queue.vk_queue, 1, &submit_info, get_render_fence());
+    }
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkQueueSubmit failed with error code (" << result << ")");
+        throw std::runtime_error("vkQueueSubmit failed! Please check the log above for more info!");
+    }
+}
+
+void Graphics::VulkanProvider::present_targets(Graphics::WindowRenderTarget *const *pp_targets, size_t count) {
+    Queue queue = get_queue(QueueType::Present);
+
+    for (size_t first = 0; first < count; first += PresentThread::MAX_SWAPCHAINS) {
+        uint32_t chunk = static_cast<uint32_t>(std::min(count - first, PresentThread::MAX_SWAPCHAINS));
+
+        // The request doubles as storage for the inline present, so neither path allocates
+        PresentThread::Request request {};
+        request.count = chunk;
+        request.frame_number = get_frame_number();
+        request.queue_time = PresentTiming::Clock::now();
+
+        for (uint32_t s = 0; s < chunk; s++) {
+            WindowRenderTarget *p_target = pp_targets[first + s];
+
+            if (p_target == nullptr) {
+                throw std::runtime_error("p_target is nullptr!");
+            }
+
+            request.vk_swapchains[s] = p_target->get_vk_swapchain();
+            request.image_indices[s] = p_target->get_vk_image_index();
+            request.vk_wait_semaphores[s] = p_target->get_vk_signal_semaphore(this);
+            request.p_targets[s] = p_target;
+        }
+
+        // The results come back through poll_present_thread at the start of a later frame
+        if (pt_present != nullptr) {
+            pt_present->push(request);
+            continue;
+        }
+
+        VkResult results[PresentThread::MAX_SWAPCHAINS] {};
+
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+        present_info.waitSemaphoreCount = chunk;
+        present_info.pWaitSemaphores = request.vk_wait_semaphores;
+
+        present_info.swapchainCount = chunk;
+        present_info.pSwapchains = request.vk_swapchains;
+        present_info.pImageIndices = request.image_indices;
+        present_info.pResults = results;
+
+        PresentTiming timing {};
+        timing.frame_number = request.frame_number;
+
+        PresentTiming::Clock::time_point start_time = PresentTiming::Clock::now();
+
+        {
+            std::lock_guard<std::mutex> queue_lock(*queue.p_mutex);
+            timing.result = vkQueuePresentKHR(queue.vk_queue, &present_info);
+        }
+
+        timing.present_time = PresentTiming::Clock::now();
+        timing.present_duration = timing.present_time - start_time;
+
+        report_present_timing(timing);
+
+        for (uint32_t s = 0; s < chunk; s++) {
+            request.p_targets[s]->handle_present_result(results[s]);
+        }
+    }
+}
+
+VkCommandBuffer Graphics::VulkanProvider::begin_upload(QueueType type, VkCommandBuffer vk_cmd_buffer) {
+    // Our upload pools allow individual resets, so beginning a recycled buffer implicitly resets it
+    VkCommandBuffer vk_upload_buffer = vk_cmd_buffer;
+
+    if (vk_upload_buffer == nullptr) {
+        vk_upload_buffer = allocate_command_buffer(type);
+    }
 
     VkCommandBufferBeginInfo buffer_begin_info{};
     buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    // TODO: Safety
-    vkBeginCommandBuffer(vk_upload_buffer, &buffer_begin_info);
+    VkResult result = vkBeginCommandBuffer(vk_upload_buffer, &buffer_begin_info);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkBeginCommandBuffer failed with error code (" << result << ")");
+        throw std::runtime_error("vkBeginCommandBuffer failed! Please check the log above for more info!");
+    }
 
     return vk_upload_buffer;
 }
 
-// TODO: SAFETY!!!
-// TODO: NOT IMMEDIATELY SUBMIT!!!
-// TODO: SAFETY AROUND UPLOAD TEMP CMD BUFFERS
-void Graphics::VulkanProvider::end_upload(QueueType type, VkCommandBuffer vk_cmd_buffer) {
+void Graphics::VulkanProvider::end_upload(QueueType type, VkCommandBuffer vk_cmd_buffer, const UploadSync &sync) {
     Queue queue = get_queue(type);
 
+    VkResult result = vkEndCommandBuffer(vk_cmd_buffer);
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkEndCommandBuffer failed with error code (" << result << ")");
+        throw std::runtime_error("vkEndCommandBuffer failed! Please check the log above for more info!");
+    }
+
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &vk_cmd_buffer;
 
-    vkEndCommandBuffer(vk_cmd_buffer);
+    if (sync.vk_wait_semaphore != nullptr) {
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &sync.vk_wait_semaphore;
+        submit_info.pWaitDstStageMask = &sync.vk_wait_stages;
+    }
+
+    if (sync.vk_signal_semaphore != nullptr) {
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &sync.vk_signal_semaphore;
+    }
 
     // TODO: Multiple uploads at once?
-    vkQueueSubmit(queue.vk_queue, 1, &submit_info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queue.vk_queue);
+    {
+        std::lock_guard<std::mutex> queue_lock(*queue.p_mutex);
+        result = vkQueueSubmit(queue.vk_queue, 1, &submit_info, sync.vk_fence);
+    }
+
+    if (result != VK_SUCCESS) {
+        LOG_GRAPHICS("Error: vkQueueSubmit failed with error code (" << result << ")");
+        throw std::runtime_error("vkQueueSubmit failed! Please check the log above for more info!");
+    }
+}
+
+void Graphics::VulkanProvider::await_upload() {
+    if (smp_staging != nullptr) {
+        smp_staging->await(this);
+    }
+}
 
-    free_command_buffer(type, vk_cmd_buffer);
+bool Graphics::VulkanProvider::has_dedicated_transfer_queue() const {
+    return queue_transfer.family != queue_graphics.family;
 }
 
 bool Graphics::VulkanProvider::get_defer_release() const {
     return defer_release;
 }
 
-void Graphics::VulkanProvider::enqueue_release(const ReleaseFunction& function) {
-    deferred_releases.emplace_back(function);
+void Graphics::VulkanProvider::enqueue_release(ReleaseFunction function) {
+    std::unique_lock<std::mutex> lock(release_mutex);
+
+    // Nothing can be in flight before the frames exist
+    if (frames.empty()) {
+        lock.unlock();
+        function(this);
+
+        return;
+    }
+
+    // The current frame is the latest one that could have recorded commands using the resource
+    frames[frame_index].releases.push_back(std::move(function));
 }
 
 // Allocates the virtual block and provides owning VkBuffer
 // Memory can be allocated but not uploaded prior to usage, please use MemoryBlock::is_uploaded() first!
-std::shared_ptr<Graphics::MemoryBlock> Graphics::VulkanProvider::upload_memory(size_t size, void* src, AllocationType type) {
+Graphics::MemoryBlockHandle Graphics::VulkanProvider::upload_memory(size_t size, void* src, AllocationType type, UploadPriority priority) {
     MemoryPool *mp_dst = nullptr;
 
     switch (type) {
@@ -1206,8 +2334,87 @@ std::shared_ptr<Graphics::MemoryBlock> Graphics::VulkanProvider::upload_memory(s
             break;
     }
 
-    auto dst = mp_dst->alloc(size);
-    smp_staging->enqueue_upload(size, src, dst);
+    MemoryBlockHandle dst = mp_dst->alloc(size);
+    MemoryBlock *p_dst = rt_memory_blocks->get(dst);
+
+    // Host visible pools are written directly, everything else goes through staging
+    if (mp_dst->write(p_dst, src, size)) {
+        mp_dst->complete_upload(p_dst);
+    } else {
+        smp_staging->enqueue_upload(this, size, src, p_dst, priority);
+    }
 
     return dst;
 }
+
+// Every request lands in the same staging batch, so the next flush copies them with as few commands as possible
+std::vector<Graphics::MemoryBlockHandle> Graphics::VulkanProvider::upload_memory(const std::vector<UploadRequest> &requests) {
+    std::vector<MemoryBlockHandle> blocks;
+    blocks.reserve(requests.size());
+
+    for (const auto& request : requests) {
+        blocks.push_back(upload_memory(request.size, request.src, request.type, request.priority));
+    }
+
+    return blocks;
+}
+
+Graphics::MemoryBlock *Graphics::VulkanProvider::get_memory_block(MemoryBlockHandle handle) {
+    return rt_memory_blocks->get(handle);
+}
+
+void Graphics::VulkanProvider::destroy_memory_block(MemoryBlockHandle handle) {
+    MemoryBlock *p_block = rt_memory_blocks->get(handle);
+
+    if (p_block != nullptr) {
+        p_block->get_pool()->destroy(p_block);
+    }
+}
+
+ResourceTable<Graphics::MemoryBlock> *Graphics::VulkanProvider::get_memory_block_table() {
+    return rt_memory_blocks;
+}
+
+Graphics::MeshBuffer *Graphics::VulkanProvider::get_mesh_buffer(MeshBufferHandle handle) {
+    return rt_mesh_buffers->get(handle);
+}
+
+void Graphics::VulkanProvider::destroy_mesh_buffer(MeshBufferHandle handle) {
+    MeshBuffer *p_mesh = rt_mesh_buffers->get(handle);
+
+    if (p_mesh != nullptr) {
+        p_mesh->release(this);
+        rt_mesh_buffers->destroy(handle);
+    }
+}
+
+Graphics::ShaderModule *Graphics::VulkanProvider::get_shader_module(ShaderModuleHandle handle) {
+    return rt_shader_modules->get(handle);
+}
+
+void Graphics::VulkanProvider::destroy_shader_module(ShaderModuleHandle handle) {
+    enqueue_release([handle](VulkanProvider *p_provider) {
+        ShaderModule *p_module = p_provider->rt_shader_modules->get(handle);
+
+        if (p_module != nullptr) {
+            p_module->release(p_provider);
+            p_provider->rt_shader_modules->destroy(handle);
+        }
+    });
+}
+
+Graphics::Shader *Graphics::VulkanProvider::get_shader(ShaderHandle handle) {
+    return rt_shaders->get(handle);
+}
+
+void Graphics::VulkanProvider::destroy_shader(ShaderHandle handle) {
+    // Frames still in flight may be drawing with the pipeline
+    enqueue_release([handle](VulkanProvider *p_provider) {
+        Shader *p_shader = p_provider->rt_shaders->get(handle);
+
+        if (p_shader != nullptr) {
+            p_shader->release(p_provider);
+            p_provider->rt_shaders->destroy(handle);
+        }
+    });
+}
@@ -28,10 +28,16 @@ SOFTWARE.
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include <data/frame_arena.hpp>
+#include <data/resource_table.hpp>
+#include <graphics/present_thread.hpp>
 #include <graphics/provider_releasable.hpp>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace Sapphire {
@@ -40,17 +46,30 @@ namespace Sapphire {
 }
 
 namespace Sapphire::Graphics {
+    class RenderTarget;
     class WindowRenderTarget;
+    class ImageRenderTarget;
     class MemoryBlock;
     class MemoryPool;
     class StagingMemoryPool;
+    class UniformRing;
+    class DescriptorAllocator;
+    class DescriptorLayoutCache;
+    class DescriptorSetCache;
+    class BindlessTable;
     class Shader;
+    class ShaderModule;
+    class MeshBuffer;
+    struct MemoryPoolStats;
+
+    using MemoryBlockHandle = Handle<MemoryBlock>;
+    using MeshBufferHandle = Handle<MeshBuffer>;
+    using ShaderHandle = Handle<Shader>;
+    using ShaderModuleHandle = Handle<ShaderModule>;
 
     // A wrapper around Vulkan instance creation / management
     class VulkanProvider {
     public:
-        using ReleaseFunction = std::function<void(VulkanProvider*)>;
-
         enum class QueueType {
             Unknown,
             Graphics,
@@ -60,9 +79,14 @@ namespace Sapphire::Graphics {
 
         struct Queue {
             uint32_t family = -1;
+            uint32_t index = 0;
             QueueType type = QueueType::Unknown;
             VkQueue vk_queue = nullptr;
             VkCommandPool vk_pool = nullptr;
+
+            // VkQueues are externally synchronized, hold this while submitting or presenting
+            // Types sharing a VkQueue share the mutex too
+            std::mutex *p_mutex = nullptr;
         };
 
         struct PresentInfo {
@@ -78,21 +102,80 @@ namespace Sapphire::Graphics {
             Buffer
         };
 
+        // How the CPU can reach device local memory
+        // Discrete: only through staging, ReBAR: all of VRAM is mappable, UMA: VRAM is system memory
+        enum class MemoryModel {
+            Discrete,
+            ReBAR,
+            UMA
+        };
+
+        // Staged uploads are submitted highest priority first, within the per-frame upload budget
+        // Uploads of the same priority go out in the order they were made
+        enum class UploadPriority : int {
+            Low,
+            Normal,
+            High,
+            Critical
+        };
+
+        // A single entry of a batched upload_memory call
+        struct UploadRequest {
+            size_t size;
+            void* src;
+            AllocationType type;
+            UploadPriority priority = UploadPriority::Normal;
+        };
+
         enum class UploadType {
             Transfer,
             Graphics
         };
 
+        // Optional sync primitives attached to an upload submission
+        struct UploadSync {
+            VkSemaphore vk_wait_semaphore = nullptr;
+            VkPipelineStageFlags vk_wait_stages = 0;
+            VkSemaphore vk_signal_semaphore = nullptr;
+            VkFence vk_fence = nullptr;
+        };
+
+        // Usage and budget of a single memory heap, in bytes
+        // The budget is an estimate of how much this process can use, it shrinks as other processes use the GPU
+        struct HeapBudget {
+            uint32_t heap_index;
+            VkMemoryHeapFlags vk_heap_flags;
+            VkDeviceSize usage;
+            VkDeviceSize budget;
+            VkDeviceSize allocated_bytes;
+            VkDeviceSize block_bytes;
+        };
+
+        using MemoryPressureCallback = std::function<void(VulkanProvider*, const HeapBudget&)>;
+
+        // Sync objects owned by a single frame in flight
+        // The CPU only waits on a frame's fence right before reusing its slot
+        // Releases queued during (or after) the frame run once that wait has returned, and the transient descriptor sets are reset
+        // Swapchain semaphores belong to each window, so any number of windows can share a frame
+        struct FrameData {
+            VkFence vk_render_fence = nullptr;
+            std::vector<ReleaseFunction> releases;
+            DescriptorAllocator *da_transient = nullptr;
+        };
+
     protected:
         VkPhysicalDeviceFeatures vk_gpu_features;
         VkPhysicalDevice vk_gpu = nullptr;
         VkDevice vk_device = nullptr;
         VkInstance vk_instance = nullptr;
 
-        VkSemaphore vk_image_available_semaphore = nullptr;
-        VkSemaphore vk_render_finished_semaphore = nullptr;
-        VkFence vk_render_fence = nullptr;
-        VkDescriptorPool vk_descriptor_pool = nullptr;
+        std::vector<FrameData> frames;
+        uint32_t frames_in_flight = 2;
+        uint32_t frame_index = 0;
+
+        // How many frames may be queued on the GPU when a new one starts recording, 0 means frames_in_flight
+        uint32_t max_queued_frames = 0;
+        std::atomic<uint64_t> frame_number = 0;
 
         VmaAllocator vma_allocator = nullptr;
 
@@ -101,24 +184,77 @@ namespace Sapphire::Graphics {
 
         PresentInfo present_info;
 
+        // Present preferences, see determine_present_info
+        bool vsync = false;
+        bool srgb = false;
+        bool d32 = false;
+
+        // 0 asks for one more than the surface minimum
+        uint32_t swapchain_images = 0;
+
         Queue queue_graphics;
         Queue queue_present;
         Queue queue_transfer;
 
+        // One per distinct VkQueue, see Queue::p_mutex
+        std::mutex queue_mutexes[3];
+
+        // Presents happen on pt_present rather than inline, nullptr if disabled or headless
+        bool use_present_thread = false;
+        PresentThread *pt_present = nullptr;
+
+        PresentTiming last_present_timing {};
+
         // TODO: User defined vertex data?
         VkVertexInputBindingDescription vk_vtx_binding;
         std::vector<VkVertexInputAttributeDescription> vk_vtx_attributes;
 
         bool defer_release = false;
-        std::vector<ReleaseFunction> deferred_releases;
 
+        // Blocks may be dropped on any thread, so releases can be queued from anywhere
+        // Also guards frame_index, so a release always lands in the queue of the frame it was tagged with
+        std::mutex release_mutex;
+
+        // The releases of the slot begin_frame is reusing, swapped with the slot's queue so neither loses its capacity
+        std::vector<ReleaseFunction> retired_releases;
+
+        // Runs (and clears) retired_releases, the GPU must be done with the frame they belonged to
+        void run_retired_releases();
+
+        // Only created with a window, its final layout needs VK_KHR_swapchain
         VkRenderPass vk_render_pass_window = nullptr;
-        // TODO: Image render pass
+
+        // Leaves the image ready to be copied out, compatible with the window pass as they share their formats
+        VkRenderPass vk_render_pass_image = nullptr;
+
+        // Initialized without a window, there is no surface, swapchain, or present
+        bool headless = false;
 
         bool validate_instance_extensions(const std::vector<const char *> &extensions, Engine *p_engine);
         bool validate_instance_layers(const std::vector<const char *> &layers, Engine *p_engine);
         bool validate_device_extensions(const std::vector<const char *> &extensions, Engine *p_engine);
 
+        bool is_instance_extension_supported(const char *extension);
+        bool is_device_extension_supported(const char *extension);
+
+        bool ext_properties2_enabled = false;
+        bool ext_memory_budget_enabled = false;
+        bool ext_descriptor_indexing_enabled = false;
+        bool ext_device_group_creation_enabled = false;
+        bool ext_buffer_device_address_enabled = false;
+
+        // Vulkan 1.0 only has the KHR entry point, which has to be loaded by hand
+        PFN_vkGetBufferDeviceAddressKHR pfn_get_buffer_device_address = nullptr;
+
+        std::vector<MemoryPressureCallback> memory_pressure_callbacks;
+        float memory_pressure_threshold = 0.9f;
+
+        // Writes the usage and budget of every heap to p_budgets (VK_MAX_MEMORY_HEAPS long), returns the heap count
+        uint32_t fill_heap_budgets(HeapBudget *p_budgets);
+
+        // Fires the pressure callbacks for every heap whose usage is over the threshold
+        void check_memory_pressure();
+
         void cache_surface_info(VkSurfaceKHR vk_surface);
         VkFormat find_supported_surface_format(const std::vector<VkFormat> &vk_formats);
         VkFormat find_supported_format(const std::vector<VkFormat> &vk_formats, VkImageTiling vk_tiling, VkFormatFeatureFlags vk_feature_flags);
@@ -128,14 +264,19 @@ namespace Sapphire::Graphics {
         void create_instance(Engine *p_engine);
         void find_gpu(Engine *p_engine, VkSurfaceKHR vk_surface);
         void create_device(Engine *p_engine);
+        void determine_memory_model(Engine *p_engine);
         void create_vma_allocator(Engine *p_engine);
-        void create_vk_descriptor_pool();
+        void create_resource_tables();
+        MemoryPool *create_memory_pool(VkBufferUsageFlags usage, bool direct_write);
+        void create_descriptor_allocators();
+        void create_uniform_ring();
+        void create_bindless_table();
+        void create_pipeline_layout();
         void create_render_passes();
         void create_vk_vtx_info();
         void warm_fallbacks();
 
-        VkSemaphore create_vk_semaphore();
-        VkFence create_vk_fence();
+        void create_frames();
 
         MemoryPool *mp_mesh = nullptr;
         MemoryPool *mp_texture = nullptr;
@@ -143,59 +284,290 @@ namespace Sapphire::Graphics {
 
         StagingMemoryPool *smp_staging = nullptr;
 
-        const size_t MP_MESH_STRIDE_MB = 100;
-        const size_t MP_TEXTURE_STRIDE_MB = 100;
-        const size_t MP_BUFFER_STRIDE_MB = 100;
+        // Layouts and long-lived sets are shared by everything, transient sets live in FrameData
+        DescriptorLayoutCache *dlc_layouts = nullptr;
+        DescriptorSetCache *dsc_sets = nullptr;
+
+        // Every resource can be reached by index through this, nullptr without VK_EXT_descriptor_indexing
+        BindlessTable *bt_bindless = nullptr;
+
+        // TODO: Let the user pick these?
+        const uint32_t BINDLESS_MAX_BUFFERS = 65536;
+        const uint32_t BINDLESS_MAX_IMAGES = 16384;
+        const uint32_t BINDLESS_MAX_SAMPLERS = 256;
+
+        // Shared by every shader: the constants sets, the bindless set (if any), and PUSH_CONSTANT_SIZE bytes of push constants
+        // Sharing it means sets bound once stay bound across pipeline changes
+        VkPipelineLayout vk_pipeline_layout = nullptr;
+
+        // Transient per-frame constants, see UniformRing
+        UniformRing *ur_constants = nullptr;
+        size_t uniform_ring_size = 1024 * 1024;
+
+        // Transient CPU memory for the main thread, reset at the start of every frame
+        FrameArena *fa_frame = nullptr;
+        size_t frame_arena_size = 256 * 1024;
+
+        MemoryModel memory_model = MemoryModel::Discrete;
+
+        // Mappable device local heaps at or below this size are the legacy BAR window, not ReBAR
+        const size_t REBAR_MIN_HEAP_MB = 256;
+
+        const size_t MP_MIN_CHUNK_MB = 4;
+        const size_t MP_MAX_CHUNK_MB = 64;
+
+        const size_t SMP_STAGING_RING_MB = 32;
+
+        // How many frames a pool chunk may sit empty before it is released
+        uint32_t pool_idle_frames = 600;
+
+        // How many bytes defragmentation may move each frame, 0 disables it
+        VkDeviceSize defrag_budget = 0;
 
-        const size_t SMP_STAGING_STRIDE_MB = 128;
+        // How many bytes of staged uploads are submitted each frame, 0 means no limit
+        VkDeviceSize upload_budget = 0;
 
-        std::shared_ptr<Shader> shader_fallback = nullptr;
+        // Every resource handed out by the provider lives in one of these, see ResourceTable
+        ResourceTable<MemoryBlock> *rt_memory_blocks = nullptr;
+        ResourceTable<MeshBuffer> *rt_mesh_buffers = nullptr;
+        ResourceTable<Shader> *rt_shaders = nullptr;
+        ResourceTable<ShaderModule> *rt_shader_modules = nullptr;
+
+        ShaderHandle shader_fallback {};
 
     public:
+        // The minimum every GPU supports, enough for a handful of bindless indices per draw
+        static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;
+
+        VkSemaphore create_vk_semaphore();
+        VkFence create_vk_fence(bool signaled = true);
+
         VkSurfaceKHR create_vk_surface(Window *p_window);
         void setup_window_render_target(WindowRenderTarget *p_target, Window *p_window);
+        void setup_image_render_target(ImageRenderTarget *p_target, VkExtent2D vk_extent);
 
         VkCommandBuffer allocate_command_buffer(QueueType queue_type);
         void free_command_buffer(QueueType queue_type, VkCommandBuffer vk_command_buffer);
 
         void reset_render_fence();
 
+        // Must be called before initialize()
+        void set_frames_in_flight(uint32_t count);
+
+        // Lower counts cut input latency at the cost of GPU idle time, 0 (or anything above frames in flight) allows frames in flight
+        void set_max_queued_frames(uint32_t count);
+
+        // Picks FIFO when enabled, otherwise the fastest present mode the surface has
+        // Window render targets only pick this up when they're recreated
+        void set_vsync(bool vsync);
+
+        // 0 asks for one more than the surface minimum, clamped to what the surface supports
+        // Window render targets only pick this up when they're recreated
+        void set_swapchain_images(uint32_t count);
+
+        // Format preferences, must be called before initialize()
+        void set_srgb(bool srgb);
+        void set_d32(bool d32);
+
+        // Presents from a dedicated thread, so the main thread can move on right after submitting
+        // Must be called before initialize()
+        void set_present_thread(bool enabled);
+
+        // How many frames an empty pool chunk is kept around before it is released
+        void set_pool_idle_frames(uint32_t count);
+
+        // How many bytes of blocks defragmentation may move each frame, 0 disables it
+        void set_defrag_budget(size_t bytes);
+
+        // How many bytes of staged uploads are submitted each frame, the rest carries over to later frames
+        // 0 submits everything every frame
+        void set_upload_budget(size_t bytes);
+
+        // How many bytes of constants can be written each frame, must be called before initialize()
+        void set_uniform_ring_size(size_t bytes);
+
+        // How many bytes the frame arena starts with, it grows if a frame doesn't fit, must be called before initialize()
+        void set_frame_arena_size(size_t bytes);
+
+        // Without a main window on the engine, the provider is initialized headless
         void initialize(Engine *p_engine);
 
         VkInstance get_vk_instance();
+        VkPhysicalDevice get_vk_gpu();
         VkDevice get_vk_device();
         VmaAllocator get_vma_allocator();
-        VkSemaphore get_image_available_semaphore();
-        VkSemaphore get_render_finished_semaphore();
         VkFence get_render_fence();
+        uint32_t get_frames_in_flight() const;
+        uint32_t get_frame_index() const;
+        uint64_t get_frame_number() const;
         VkRenderPass get_render_pass_window();
+        VkRenderPass get_render_pass_image();
         Queue get_queue(QueueType type);
         VkVertexInputBindingDescription get_vk_vtx_binding();
-        std::vector<VkVertexInputAttributeDescription> get_vk_vtx_attributes();
-        std::shared_ptr<Shader> get_shader_fallback();
+        const std::vector<VkVertexInputAttributeDescription>& get_vk_vtx_attributes();
+        ShaderHandle get_shader_fallback();
+        UniformRing *get_uniform_ring();
+
+        // nullptr if the GPU doesn't support VK_EXT_descriptor_indexing
+        BindlessTable *get_bindless_table();
+
+        // nullptr if presents happen inline
+        PresentThread *get_present_thread();
+
+        // Hands the present thread's results back to their targets, called every frame
+        // Window targets call it before they're released too, so no result outlives its target
+        void poll_present_thread();
+
+        // Called by window targets whenever a present returns
+        void report_present_timing(const PresentTiming &timing);
+
+        // The most recent present that returned, use it to pace frames against the display
+        [[nodiscard]]
+        PresentTiming get_present_timing() const;
+
+        // The pipeline layout every shader is compiled against
+        VkPipelineLayout get_vk_pipeline_layout();
+
+        // Identical binding lists share a layout, see DescriptorLayoutCache
+        DescriptorLayoutCache *get_descriptor_layout_cache();
 
-        // Call before any rendering occurs
+        // Long-lived sets, cached by their bindings, see DescriptorSetCache
+        DescriptorSetCache *get_descriptor_set_cache();
+
+        // A set that is only valid until this frame slot is reused, main thread only
+        // Meant for per-draw data that changes every frame, anything reused across frames belongs in the set cache
+        VkDescriptorSet allocate_transient_set(VkDescriptorSetLayout vk_layout);
+
+        // Main thread only, anything allocated from it is gone once the next frame begins
+        FrameArena *get_frame_arena();
+
+        // Call before any rendering occurs, from the main thread only
         void flush();
 
         // Signals to the provider and renderer objects that we're now rendering
+        // begin_frame advances to the next frame slot and waits until the GPU is done with it
         void begin_frame();
         void end_frame();
 
+        // Waits on the fence of the current frame slot
         void await_frame();
 
-        // Begins an upload
+        // Blocks until no more than max_queued_frames frames are queued, begin_frame does this too
+        // Calling it before polling input lets the input be sampled as late as possible
+        void await_queued_frames();
+
+        // Submits the recorded command buffers of every target with a single vkQueueSubmit, signalling the frame's fence
+        // Main thread only, and only once per frame
+        void submit_targets(RenderTarget *const *pp_targets, size_t count);
+
+        // Presents every window with a single vkQueuePresentKHR (one per PresentThread::MAX_SWAPCHAINS windows)
+        // Main thread only, the windows must have been rendered by this frame's submit_targets
+        void present_targets(WindowRenderTarget *const *pp_targets, size_t count);
+
+        // Begins an upload, pass a previously submitted (and retired) command buffer to recycle it
         // TODO: Make this cleaner?
-        VkCommandBuffer begin_upload(QueueType type);
-        void end_upload(QueueType queue_type, VkCommandBuffer vk_cmd_buffer);
+        VkCommandBuffer begin_upload(QueueType type, VkCommandBuffer vk_cmd_buffer = nullptr);
 
-        // TODO: await_upload();
+        // Ends and submits an upload without waiting on it
+        // The command buffer must be kept alive until sync.vk_fence signals
+        void end_upload(QueueType queue_type, VkCommandBuffer vk_cmd_buffer, const UploadSync &sync);
+
+        // Submits every queued upload regardless of the budget, then blocks until they have all landed
         void await_upload();
 
+        // Is the transfer queue in a different family than the graphics queue?
+        // If so, uploaded ranges need a queue family ownership transfer before rendering can use them
+        [[nodiscard]]
+        bool has_dedicated_transfer_queue() const;
+
         [[nodiscard]]
         bool get_defer_release() const;
-        void enqueue_release(const ReleaseFunction& function);
+        // Runs the function once the GPU has finished the current frame, safe to call from any thread
+        void enqueue_release(ReleaseFunction function);
+
+        // Safe to call from any thread, the copy is submitted by a later flush() on the main thread
+        // Higher priority uploads are submitted first when there's more queued than the upload budget allows
+        MemoryBlockHandle upload_memory(size_t size, void* src, AllocationType type, UploadPriority priority = UploadPriority::Normal);
+
+        // Uploads many buffers at once, blocks are returned in the same order as the requests
+        std::vector<MemoryBlockHandle> upload_memory(const std::vector<UploadRequest> &requests);
+
+        //
+        // Resources
+        //
+        // Lookups return nullptr for stale handles, the pointer is only valid until the resource is destroyed
+        // Destroying is explicit, anything the GPU may still be using is released once the frames in flight have finished
+
+        // Blocks go stale right away, their range is freed once the GPU is done with it (or the upload / move has landed)
+        MemoryBlock *get_memory_block(MemoryBlockHandle handle);
+        void destroy_memory_block(MemoryBlockHandle handle);
+        ResourceTable<MemoryBlock> *get_memory_block_table();
+
+        // Takes the same arguments as the MeshBuffer constructor, minus the provider
+        template<typename... Args>
+        MeshBufferHandle create_mesh_buffer(Args&&... args) {
+            return rt_mesh_buffers->create(this, std::forward<Args>(args)...);
+        }
+
+        // Mesh buffers go stale right away, only their memory blocks have to wait on the GPU
+        MeshBuffer *get_mesh_buffer(MeshBufferHandle handle);
+        void destroy_mesh_buffer(MeshBufferHandle handle);
+
+        // Takes the same arguments as the compiling ShaderModule constructor, minus the provider
+        template<typename... Args>
+        ShaderModuleHandle create_shader_module(Args&&... args) {
+            return rt_shader_modules->create(this, std::forward<Args>(args)...);
+        }
+
+        ShaderModule *get_shader_module(ShaderModuleHandle handle);
+        void destroy_shader_module(ShaderModuleHandle handle);
+
+        // Takes the same arguments as the Shader constructor, minus the provider
+        template<typename... Args>
+        ShaderHandle create_shader(Args&&... args) {
+            return rt_shaders->create(this, std::forward<Args>(args)...);
+        }
+
+        // Shaders stay valid until the frames that may be drawing with them have finished
+        Shader *get_shader(ShaderHandle handle);
+        void destroy_shader(ShaderHandle handle);
+
+        // Pools of host visible memory skip staging, see MemoryModel
+        [[nodiscard]]
+        MemoryModel get_memory_model() const;
+
+        // Per-heap usage and budget, refreshed every frame
+        std::vector<HeapBudget> get_heap_budgets();
+
+        // Was the provider initialized without a window? If so, only image render targets can be used
+        [[nodiscard]]
+        bool is_headless() const;
+
+        // Is VK_EXT_memory_budget enabled? If not, budgets are estimated from the heap sizes
+        [[nodiscard]]
+        bool has_memory_budget() const;
+
+        // Is VK_EXT_descriptor_indexing enabled? If not, there is no bindless table
+        [[nodiscard]]
+        bool has_descriptor_indexing() const;
+
+        // Is VK_KHR_buffer_device_address enabled? If not, every address is 0
+        [[nodiscard]]
+        bool has_buffer_device_address() const;
+
+        // The GPU address of the start of the buffer, the buffer must be from one of the provider's pools
+        VkDeviceAddress get_vk_buffer_address(VkBuffer vk_buffer);
+
+        // Called during flush for every heap whose usage is over threshold * budget
+        // Use it to evict or downsample resources before allocations start failing
+        void add_memory_pressure_callback(const MemoryPressureCallback &callback);
+        void set_memory_pressure_threshold(float threshold);
+
+        // Usage of the mesh, texture, buffer and staging pools, down to each chunk
+        std::vector<MemoryPoolStats> get_memory_stats();
 
-        std::shared_ptr<MemoryBlock> upload_memory(size_t size, void* src, AllocationType type);
+        // Writes the pool stats, heap budgets and VMA's detailed map of every allocation to path as JSON
+        void dump_memory_report(const std::string &path);
     };
 }
 
@@ -67,7 +67,7 @@ void Window::set_render_target(Graphics::WindowRenderTarget *p_target) {
 //
 // Frame management
 //
-Graphics::WindowRenderTarget *Window::begin_frame(Engine *p_engine) {
+Graphics::WindowRenderTarget *Window::update_render_target(Engine *p_engine) {
     if (p_engine == nullptr) {
         throw std::runtime_error("p_engine was nullptr!");
     }
@@ -76,12 +76,20 @@ Graphics::WindowRenderTarget *Window::begin_frame(Engine *p_engine) {
         throw std::runtime_error("target was nullptr!");
     }
 
-    // Recreate the swapchain if dirty
-    if (dirty) {
+    // Recreate the swapchain if dirty, and we're not in the middle of a resize
+    bool settled = std::chrono::steady_clock::now() - resize_time >= RESIZE_SETTLE_TIME;
+
+    if (dirty && settled) {
         target->recreate(p_engine->get_vk_provider(), this);
         dirty = false;
     }
 
+    return target;
+}
+
+Graphics::WindowRenderTarget *Window::begin_frame(Engine *p_engine) {
+    update_render_target(p_engine);
+
     target->begin_target(p_engine->get_vk_provider());
     return target;
 }
@@ -157,9 +165,33 @@ void Window::mark_dirty() {
     dirty = true;
 }
 
+void Window::mark_resized() {
+    dirty = true;
+    resize_time = std::chrono::steady_clock::now();
+}
+
 //
 // Getters
 //
 SDL_Window *Window::get_handle() {
     return handle;
-}
\ No newline at end of file
+}
+
+Graphics::WindowRenderTarget *Window::get_render_target() {
+    return target;
+}
+
+uint32_t Window::get_id() {
+    validate_window();
+    return SDL_GetWindowID(handle);
+}
+
+bool Window::is_minimized() {
+    validate_window();
+    return SDL_GetWindowFlags(handle) & SDL_WINDOW_MINIMIZED;
+}
+
+bool Window::has_focus() {
+    validate_window();
+    return SDL_GetWindowFlags(handle) & SDL_WINDOW_INPUT_FOCUS;
+}
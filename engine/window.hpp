@@ -27,6 +27,8 @@ SOFTWARE.
 
 typedef struct SDL_Window SDL_Window;
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 
 namespace Sapphire {
@@ -43,6 +45,11 @@ namespace Sapphire {
         // Did something change on this window?
         bool dirty = false;
 
+        // Resizes come in storms while an edge is dragged, the swapchain is only rebuilt once they stop for RESIZE_SETTLE_TIME
+        // Until then the old swapchain is presented as is
+        std::chrono::steady_clock::time_point resize_time {};
+        static constexpr std::chrono::milliseconds RESIZE_SETTLE_TIME {50};
+
         SDL_Window *handle = nullptr;
         Graphics::WindowRenderTarget *target = nullptr;
 
@@ -66,6 +73,10 @@ namespace Sapphire {
         // Frame management
         //
 
+        // Rebuilds the swapchain if it's dirty and the window has settled, returns the render target
+        // Main thread only, the target can then be recorded on any thread
+        Graphics::WindowRenderTarget* update_render_target(Engine *p_engine);
+
         // TODO: Make this safer ffs!
         Graphics::WindowRenderTarget* begin_frame(Engine *p_engine);
         void end_frame(Engine *p_engine);
@@ -82,10 +93,20 @@ namespace Sapphire {
         void set_resizable(bool resizable);
         void mark_dirty();
 
+        // Like mark_dirty, but waits for the resizing to settle before the swapchain is rebuilt
+        void mark_resized();
+
         //
         // Getters
         //
         SDL_Window *get_handle();
+        Graphics::WindowRenderTarget *get_render_target();
+
+        // Matches the windowID of SDL window events
+        uint32_t get_id();
+
+        bool is_minimized();
+        bool has_focus();
     };
 }
 
@@ -32,6 +32,8 @@ World::Transform::Transform() {
     position = glm::vec3(0, 0, 0);
     rotation = glm::identity<glm::quat>();
     scale = glm::vec3(1, 1, 1);
+
+    dirty = true;
 }
 
 void World::Transform::recalculate_matrices() {
@@ -42,6 +44,8 @@ void World::Transform::recalculate_matrices() {
         local_to_world = glm::translate(local_to_world, position);
         local_to_world *= glm::toMat4(rotation);
         local_to_world = glm::scale(local_to_world, scale);
+
+        world_to_local = glm::inverse(local_to_world);
     }
 
     dirty = false;
@@ -0,0 +1,58 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// sapphire_address.glsl
+//
+// This provides pointer types for reading pool memory through GPU addresses, see MemoryBlock::get_vk_address()
+// Include it before anything else, the extensions have to come before any declarations
+// Addresses are usually handed over through push constants, two uints per address (low bits first)
+//
+
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+// Matches MeshBuffer::Vertex, floats keep the struct tightly packed like it is on the CPU
+struct SapphireVertex {
+    float position[3];
+    float normal[3];
+    float uv0[2];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SapphireVertexPointer {
+    SapphireVertex vertices[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SapphireTrianglePointer {
+    uint indices[];
+};
+
+// Raw per-object data, interpret it however the shader needs to
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer SapphireDataPointer {
+    uint data[];
+};
+
+#define SAPPHIRE_VERTEX_POINTER(address) SapphireVertexPointer(address)
+#define SAPPHIRE_TRIANGLE_POINTER(address) SapphireTrianglePointer(address)
+#define SAPPHIRE_DATA_POINTER(address) SapphireDataPointer(address)
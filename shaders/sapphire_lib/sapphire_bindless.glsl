@@ -0,0 +1,54 @@
+/*
+MIT License
+
+Copyright (c) 2023 zCubed (Liam R.)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//
+// sapphire_bindless.glsl
+//
+// This provides the global bindless table, see BindlessTable
+// Include it before anything else, the extension has to come before any declarations
+// Resources are picked by index, usually from SAPPHIRE_PUSH (or instance data) rather than by binding sets per draw
+//
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define SAPPHIRE_SET_BINDLESS 2
+
+// Blocks handed out by VulkanProvider::upload_memory, see MemoryBlock::get_bindless_index()
+layout(set = SAPPHIRE_SET_BINDLESS, binding = 0) readonly buffer SAPPHIRE_BINDLESS_BUFFER {
+    uint data[];
+} SAPPHIRE_BUFFERS[];
+
+layout(set = SAPPHIRE_SET_BINDLESS, binding = 1) uniform texture2D SAPPHIRE_TEXTURES[];
+layout(set = SAPPHIRE_SET_BINDLESS, binding = 2) uniform sampler SAPPHIRE_SAMPLERS[];
+
+// VulkanProvider::PUSH_CONSTANT_SIZE bytes, shared by every stage
+#ifndef SAPPHIRE_NO_PUSH_CONSTANTS
+layout(push_constant) uniform PUSH_CONSTANTS {
+    uint indices[32];
+} SAPPHIRE_PUSH;
+#endif
+
+// Indices may differ between invocations, so they always need nonuniformEXT
+#define SAPPHIRE_BUFFER(index) SAPPHIRE_BUFFERS[nonuniformEXT(index)].data
+#define SAPPHIRE_TEXTURE(texture_index, sampler_index) sampler2D(SAPPHIRE_TEXTURES[nonuniformEXT(texture_index)], SAPPHIRE_SAMPLERS[nonuniformEXT(sampler_index)])
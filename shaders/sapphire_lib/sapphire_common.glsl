@@ -29,6 +29,7 @@ SOFTWARE.
 #ifndef SAPPHIRE_NO_CBUFFERS
 layout(set = 0, binding = 0) uniform CBUFFER_VIEW {
     // Camera data
+    // view is the combined projection * world_to_camera
     mat4 projection;
     mat4 view;
     mat4 world_to_camera;
@@ -36,4 +37,10 @@ layout(set = 0, binding = 0) uniform CBUFFER_VIEW {
 
     vec4 camera_position;
 } SAPPHIRE_CBUFFER_VIEW;
+
+// Bound per draw by the renderer
+layout(set = 1, binding = 0) uniform CBUFFER_DRAW {
+    mat4 local_to_world;
+    mat4 world_to_local;
+} SAPPHIRE_CBUFFER_DRAW;
 #endif
\ No newline at end of file